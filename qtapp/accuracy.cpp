@@ -0,0 +1,56 @@
+#include "accuracy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+std::vector<double> renderReference(const FractalParameters &params,
+                                    const ExportSettings &s) {
+  std::vector<double> data(static_cast<size_t>(s.W) * s.H);
+  // The families as written, not what Fractal::Create() plans for them, and
+  // without their shortcuts.
+  const auto fractal = Fractal::Create(&params, false);
+  if (!fractal) return data;
+  using Calc = double (Fractal::*)(const cmplx &) const;
+  const Calc calc = params.orbit_trap
+                        ? (params.mandelbrot ? &Fractal::CalcFinalNormMandelbrot
+                                             : &Fractal::CalcFinalNormJulia)
+                        : (params.mandelbrot ? &Fractal::CalcEscapeMandelbrot
+                                             : &Fractal::CalcEscapeJulia);
+  const dbltype dx = s.W > 1 ? (s.x1 - s.x0) / (s.W - 1) : 0.0;
+  const dbltype dy = s.H > 1 ? (s.y1 - s.y0) / (s.H - 1) : 0.0;
+  for (int i = 0; i < s.H; ++i) {
+    double *d = &data[static_cast<size_t>(i) * s.W];
+    for (int j = 0; j < s.W; ++j) {
+      d[j] = (fractal.get()->*calc)({s.x0 + j * dx, s.y0 + i * dy});
+    }
+  }
+  return data;
+}
+
+AccuracyReport compareImages(const std::vector<double> &image,
+                             const std::vector<double> &reference) {
+  AccuracyReport r;
+  r.pixels = std::min(image.size(), reference.size());
+  // Missing pixels differ.
+  r.mismatches = std::max(image.size(), reference.size()) - r.pixels;
+  double sum_rel = 0.0;
+  for (size_t k = 0; k < r.pixels; ++k) {
+    const double a = image[k];
+    const double b = reference[k];
+    if (a == b || (std::isnan(a) && std::isnan(b))) continue;
+    ++r.mismatches;
+    if (!std::isfinite(a) || !std::isfinite(b)) {
+      ++r.nonfinite;
+      continue;
+    }
+    const double diff = std::abs(a - b);
+    const double rel =
+        diff / std::max(std::abs(b), std::numeric_limits<double>::min());
+    r.max_abs_diff = std::max(r.max_abs_diff, diff);
+    r.max_rel_error = std::max(r.max_rel_error, rel);
+    sum_rel += rel;
+  }
+  if (r.pixels) r.mean_rel_error = sum_rel / r.pixels;
+  return r;
+}
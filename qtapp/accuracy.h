@@ -0,0 +1,34 @@
+#ifndef ACCURACY_H
+#define ACCURACY_H
+#include <cstddef>
+#include <vector>
+
+#include "exporter.h"
+#include "fractals.h"
+
+// The image of `params` over the area of `s` (W x H pixels, the same grid as
+// the exports) computed pixel by pixel on the calling thread with the scalar
+// CalcEscape* / CalcFinalNorm* of the family. Fast paths are compared to it.
+std::vector<double> renderReference(const FractalParameters &params,
+                                    const ExportSettings &s);
+
+// How far an image is from its reference. The difference of the escape time
+// is the iteration count difference, the one of a final norm the error in
+// the trap distance.
+struct AccuracyReport {
+  size_t pixels = 0;
+  size_t mismatches = 0;  // pixels that differ at all
+  size_t nonfinite = 0;   // of them, NaN or infinite on one side only
+  double max_abs_diff = 0.0;
+  double max_rel_error = 0.0;  // relative to the reference value
+  double mean_rel_error = 0.0;
+
+  double mismatchRate() const {
+    return pixels ? static_cast<double>(mismatches) / pixels : 0.0;
+  }
+};
+
+AccuracyReport compareImages(const std::vector<double> &image,
+                             const std::vector<double> &reference);
+
+#endif  // ACCURACY_H
@@ -0,0 +1,247 @@
+#include "autotune.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "renderjob.h"
+
+namespace {
+
+// The calibration renders, small enough that all of them take a few seconds
+// and large enough for some tiles per worker.
+constexpr int kWidth = 256;
+constexpr int kHeight = 144;
+constexpr int kMaxIterations = 100;
+constexpr int kRuns = 3;
+const int kGrains[] = {1, 2, 4, 8, 16};
+// A configuration replaces the current best one when it is faster by more
+// than this share, so that noise doesn't pick it.
+constexpr double kMinGain = 0.05;
+
+std::atomic<int> tuned_grain[kTunedFamilies] = {1, 1, 1, 1, 1};
+
+std::string trim(const std::string &s) {
+  const size_t first = s.find_first_not_of(" \t\r");
+  if (first == std::string::npos) return {};
+  return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// The startup view of the application with `family`, a power that has
+// kernels for the families with a power, and fewer iterations.
+FractalParameters calibrationParams(int family, bool mandelbrot) {
+  FractalParameters p = RenderJob().params;
+  p.fractal_family = family;
+  p.n = family >= 2 ? 3 : 2;
+  p.mandelbrot = mandelbrot;
+  p.max_iterations = kMaxIterations;
+  return p;
+}
+
+// Seconds of the fastest of kRuns renders of the Julia and the Mandelbrot
+// views of `family`, in tiles of `grain` rows.
+double timeFamily(int family, int grain) {
+  const ExportSettings s = RenderJob().settings;
+  const double dx = (s.x1 - s.x0) / (kWidth - 1);
+  const double dy = (s.y1 - s.y0) / (kHeight - 1);
+  std::vector<double> data(static_cast<size_t>(kWidth) * kHeight);
+  double total = 0.0;
+  for (bool mandelbrot : {false, true}) {
+    const FractalParameters p = calibrationParams(family, mandelbrot);
+    auto fractal = Fractal::Create(&p);
+    double best = 0.0;
+    for (int run = 0; run < kRuns; ++run) {
+      const auto start = std::chrono::steady_clock::now();
+      RenderScheduler::instance().parallelFor(
+          RenderPriority::Interactive, 0, kHeight,
+          [&](int i) {
+            fractal->EvaluateSpan(mandelbrot, false, s.x0, dx, 0, kWidth,
+                                  s.y0 + i * dy,
+                                  &data[static_cast<size_t>(i) * kWidth]);
+          },
+          grain);
+      const double seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+      if (run == 0 || seconds < best) best = seconds;
+    }
+    total += best;
+  }
+  return total;
+}
+
+}  // namespace
+
+std::string machineId() {
+  std::string model = "unknown CPU";
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      model = trim(line.substr(line.find(':') + 1));
+      break;
+    }
+  }
+  return model + ", " + std::to_string(std::thread::hardware_concurrency()) +
+         " CPUs";
+}
+
+std::string defaultTuningFile() {
+  std::string dir;
+  if (const char *config = std::getenv("XDG_CONFIG_HOME")) {
+    dir = config;
+  } else if (const char *home = std::getenv("HOME")) {
+    dir = std::string(home) + "/.config";
+  }
+  if (dir.empty()) return "fractalgen-tuning.conf";
+  return dir + "/fractalgen/tuning.conf";
+}
+
+bool loadTuning(const std::string &fname, TuningProfile *profile,
+                std::string *error) {
+  std::ifstream ifile(fname);
+  if (!ifile) {
+    *error = "can not open " + fname;
+    return false;
+  }
+  TuningProfile loaded;
+  std::string line;
+  for (int number = 1; std::getline(ifile, line); ++number) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+    const std::string where = fname + ":" + std::to_string(number) + ": ";
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      *error = where + "expected key = value";
+      return false;
+    }
+    const std::string key = trim(line.substr(0, eq));
+    std::istringstream in(line.substr(eq + 1));
+    bool ok = true;
+    if (key == "machine") {
+      loaded.machine = trim(line.substr(eq + 1));
+    } else if (key == "workers") {
+      ok = static_cast<bool>(in >> loaded.workers) && loaded.workers >= 0;
+    } else if (key.size() == 7 && key.compare(0, 6, "family") == 0 &&
+               key[6] >= '0' && key[6] < '0' + kTunedFamilies) {
+      const int family = key[6] - '0';
+      std::string isa;
+      ok = static_cast<bool>(in >> isa >> loaded.grain[family]) &&
+           parseIsa(isa, &loaded.isa[family]) && loaded.grain[family] > 0;
+    } else {
+      *error = where + "unknown key " + key;
+      return false;
+    }
+    std::string rest;
+    if (!ok || in >> rest) {
+      *error = where + "bad value for " + key;
+      return false;
+    }
+  }
+  *profile = loaded;
+  return true;
+}
+
+bool saveTuning(const std::string &fname, const TuningProfile &profile,
+                std::string *error) {
+  std::error_code ec;
+  const std::filesystem::path parent =
+      std::filesystem::path(fname).parent_path();
+  if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+  std::ofstream ofile(fname);
+  ofile << "# Written by the calibration of FractalGen, delete it or run\n"
+           "# with --tune to measure again.\n"
+        << "machine = " << profile.machine << "\n"
+        << "workers = " << profile.workers << "\n";
+  for (int f = 0; f < kTunedFamilies; ++f) {
+    ofile << "family" << f << " = " << isaName(profile.isa[f]) << " "
+          << profile.grain[f] << "      # build, rows per tile\n";
+  }
+  if (!ofile.flush()) {
+    *error = "can not write " + fname;
+    return false;
+  }
+  return true;
+}
+
+TuningProfile calibrate(const SchedulerSettings &settings,
+                        const std::function<void(const std::string &)> &log) {
+  auto &scheduler = RenderScheduler::instance();
+  TuningProfile profile;
+  profile.machine = machineId();
+  Isa previous[kTunedFamilies];
+  for (int f = 0; f < kTunedFamilies; ++f) {
+    previous[f] = familyIsa(f);
+    profile.isa[f] = previous[f];
+  }
+
+  // Worker counts: every allowed CPU, then halving, with the builds and tile
+  // heights of the application.
+  SchedulerSettings trial = settings;
+  trial.workers = 0;
+  scheduler.configure(trial);
+  const int cpus = scheduler.workerCount();
+  char line[128];
+  double best = 0.0;
+  for (int workers = cpus; workers >= 1; workers /= 2) {
+    trial.workers = workers;
+    scheduler.configure(trial);
+    double seconds = 0.0;
+    for (int f = 0; f < kTunedFamilies; ++f) seconds += timeFamily(f, 1);
+    std::snprintf(line, sizeof(line), "%3d workers: %8.2f ms", workers,
+                  seconds * 1e3);
+    if (log) log(line);
+    if (workers == cpus || seconds < best * (1.0 - kMinGain)) {
+      best = seconds;
+      profile.workers = workers;
+    }
+  }
+
+  // Builds and tile heights per family, on the chosen workers. The builds
+  // are tried from the widest, which is the default.
+  trial.workers = profile.workers;
+  scheduler.configure(trial);
+  for (int f = 0; f < kTunedFamilies; ++f) {
+    best = 0.0;
+    bool first = true;
+    for (int isa = static_cast<int>(detectedIsa()); isa >= 0; --isa) {
+      setFamilyIsa(f, static_cast<Isa>(isa));
+      for (int grain : kGrains) {
+        const double seconds = timeFamily(f, grain);
+        std::snprintf(line, sizeof(line), "family%d %-6s %2d rows: %8.2f ms",
+                      f, isaName(static_cast<Isa>(isa)), grain, seconds * 1e3);
+        if (log) log(line);
+        if (first || seconds < best * (1.0 - kMinGain)) {
+          best = seconds;
+          profile.isa[f] = static_cast<Isa>(isa);
+          profile.grain[f] = grain;
+          first = false;
+        }
+      }
+    }
+    setFamilyIsa(f, previous[f]);
+  }
+
+  scheduler.configure(settings);
+  return profile;
+}
+
+bool applyTuning(const TuningProfile &profile, bool isa) {
+  bool ok = true;
+  for (int f = 0; f < kTunedFamilies; ++f) {
+    tuned_grain[f] = profile.grain[f];
+    if (isa && !setFamilyIsa(f, profile.isa[f])) ok = false;
+  }
+  return ok;
+}
+
+int tunedGrain(int family) {
+  if (family < 0 || family >= kTunedFamilies) return 1;
+  return tuned_grain[family].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+#include <functional>
+#include <string>
+
+#include "cpufeatures.h"
+#include "renderscheduler.h"
+
+constexpr int kTunedFamilies = 5;
+
+// What the calibration found fastest on a machine: the number of workers,
+// and per family the build of the kernels and the rows per scheduler tile.
+struct TuningProfile {
+  std::string machine;  // machineId() of the calibration
+  int workers = 0;      // 0 for one per allowed CPU
+  Isa isa[kTunedFamilies] = {Isa::Sse2, Isa::Sse2, Isa::Sse2, Isa::Sse2,
+                             Isa::Sse2};
+  int grain[kTunedFamilies] = {1, 1, 1, 1, 1};
+};
+
+// The CPU model and the number of CPUs, a profile of another machine is
+// measured again.
+std::string machineId();
+// $XDG_CONFIG_HOME/fractalgen/tuning.conf, ~/.config/... without it.
+std::string defaultTuningFile();
+
+// A file of "key = value" lines like the parameter files of renderjob.h:
+//
+//   machine = Intel(R) Xeon(R) Gold 6338 CPU @ 2.00GHz, 128 CPUs
+//   workers = 64
+//   family0 = avx512 2      # build, rows per tile
+//
+// Returns false with a message in `error` when the file is missing or bad.
+bool loadTuning(const std::string &fname, TuningProfile *profile,
+                std::string *error);
+bool saveTuning(const std::string &fname, const TuningProfile &profile,
+                std::string *error);
+
+// Times short renders of the startup view of every family, Julia and
+// Mandelbrot, first over worker counts, then over the kernel builds the CPU
+// runs and the tile heights. Takes a few seconds. The workers are restarted
+// with `settings` and each count, so it runs before any render, and left with
+// `settings` as given. `log` gets a line per measured configuration.
+TuningProfile calibrate(const SchedulerSettings &settings,
+                        const std::function<void(const std::string &)> &log =
+                            {});
+
+// Makes the interactive frames and the exports use the tile heights of the
+// profile and, with `isa`, its kernel builds. The worker count goes in the SchedulerSettings of the
+// caller. Returns false when this CPU can not run some build of the profile.
+bool applyTuning(const TuningProfile &profile, bool isa);
+
+// Rows per scheduler tile of the renders of `family`, 1 without a profile.
+int tunedGrain(int family);
+
+#endif  // AUTOTUNE_H
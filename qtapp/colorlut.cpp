@@ -0,0 +1,257 @@
+#include "colorlut.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "kernels.h"
+
+namespace {
+
+constexpr float kMax16 = 65535.0f;
+
+inline uint32_t rgb(int r, int g, int b) {
+  return 0xff000000u | ((r & 0xff) << 16) | ((g & 0xff) << 8) | (b & 0xff);
+}
+
+inline int round16(float v) { return static_cast<int>(v * kMax16 + 0.5f); }
+
+// QColor keeps 16 bits per channel, these follow its HSV conversions so the
+// HSV gradients match the ones built by ColorMapper.
+struct Hsv {
+  float h, s, v;  // h is -1 for grays
+};
+
+Hsv toHsv(uint32_t color) {
+  const float r = ((color >> 16) & 0xff) * 257 / kMax16;
+  const float g = ((color >> 8) & 0xff) * 257 / kMax16;
+  const float b = (color & 0xff) * 257 / kMax16;
+  const float max = std::max({r, g, b});
+  const float min = std::min({r, g, b});
+  const float delta = max - min;
+  const float value = round16(max) / kMax16;
+  if (std::abs(delta) <= 0.00001f) return {-1.0f, 0.0f, value};
+
+  auto fuzzyEqual = [](float a, float b) {
+    return std::abs(a - b) * 100000.f <= std::min(std::abs(a), std::abs(b));
+  };
+  float hue = 0.0f;
+  if (fuzzyEqual(r, max)) {
+    hue = (g - b) / delta;
+  } else if (fuzzyEqual(g, max)) {
+    hue = 2.0f + (b - r) / delta;
+  } else {
+    hue = 4.0f + (r - g) / delta;
+  }
+  hue *= 60.0f;
+  if (hue < 0.0f) hue += 360.0f;
+  return {static_cast<int>(hue * 100.0f + 0.5f) / 36000.0f,
+          round16(delta / max) / kMax16, value};
+}
+
+uint32_t fromHsv(float hue, float saturation, float value) {
+  const int h16 = hue == -1.0f ? 65535 : static_cast<int>(hue * 36000 + 0.5f);
+  const int s16 = round16(saturation);
+  const int v16 = round16(value);
+  auto to8 = [](int c) { return (c - (c >> 8) + 0x80) >> 8; };
+  if (s16 == 0 || h16 == 65535) return rgb(to8(v16), to8(v16), to8(v16));
+
+  const float h = h16 == 36000 ? 0.0f : h16 / 6000.0f;
+  const float s = s16 / kMax16;
+  const float v = v16 / kMax16;
+  const int i = static_cast<int>(h);
+  const float f = h - i;
+  const float p = v * (1.0f - s);
+  const float q = v * (1.0f - s * f);
+  const float t = v * (1.0f - s * (1.0f - f));
+  // (r, g, b) for each sextant of the hue circle.
+  const float sextants[6][3] = {{v, t, p}, {q, v, p}, {p, v, t},
+                                {p, q, v}, {t, p, v}, {v, p, q}};
+  const float *c = sextants[std::clamp(i, 0, 5)];
+  return rgb(to8(round16(c[0])), to8(round16(c[1])), to8(round16(c[2])));
+}
+
+}  // namespace
+
+const std::vector<ColorPreset> &colorPresets() {
+  static const std::vector<ColorPreset> presets = {
+      {"gpGrayscale", false, {{0, rgb(0, 0, 0)}, {1, rgb(255, 255, 255)}}},
+      {"gpHot",
+       false,
+       {{0, rgb(50, 0, 0)},
+        {0.2, rgb(180, 10, 0)},
+        {0.4, rgb(245, 50, 0)},
+        {0.6, rgb(255, 150, 10)},
+        {0.8, rgb(255, 255, 50)},
+        {1, rgb(255, 255, 255)}}},
+      {"gpCold",
+       false,
+       {{0, rgb(0, 0, 50)},
+        {0.2, rgb(0, 10, 180)},
+        {0.4, rgb(0, 50, 245)},
+        {0.6, rgb(10, 150, 255)},
+        {0.8, rgb(50, 255, 255)},
+        {1, rgb(255, 255, 255)}}},
+      {"gpNight", true, {{0, rgb(10, 20, 30)}, {1, rgb(250, 255, 250)}}},
+      {"gpCandy", true, {{0, rgb(0, 0, 255)}, {1, rgb(255, 250, 250)}}},
+      {"gpGeography",
+       false,
+       {{0, rgb(70, 170, 210)},
+        {0.20, rgb(90, 160, 180)},
+        {0.25, rgb(45, 130, 175)},
+        {0.30, rgb(100, 140, 125)},
+        {0.5, rgb(100, 140, 100)},
+        {0.6, rgb(130, 145, 120)},
+        {0.7, rgb(140, 130, 120)},
+        {0.9, rgb(180, 190, 190)},
+        {1, rgb(210, 210, 230)}}},
+      {"gpIon",
+       true,
+       {{0, rgb(50, 10, 10)},
+        {0.45, rgb(0, 0, 255)},
+        {0.8, rgb(0, 255, 255)},
+        {1, rgb(0, 255, 0)}}},
+      {"gpThermal",
+       false,
+       {{0, rgb(0, 0, 50)},
+        {0.15, rgb(20, 0, 120)},
+        {0.33, rgb(200, 30, 140)},
+        {0.6, rgb(255, 100, 0)},
+        {0.85, rgb(255, 255, 40)},
+        {1, rgb(255, 255, 255)}}},
+      {"gpPolar",
+       false,
+       {{0, rgb(50, 255, 255)},
+        {0.18, rgb(10, 70, 255)},
+        {0.28, rgb(10, 10, 190)},
+        {0.5, rgb(0, 0, 0)},
+        {0.72, rgb(190, 10, 10)},
+        {0.82, rgb(255, 70, 10)},
+        {1, rgb(255, 255, 50)}}},
+      {"gpSpectrum",
+       true,
+       {{0, rgb(50, 0, 50)},
+        {0.15, rgb(0, 0, 255)},
+        {0.35, rgb(0, 255, 255)},
+        {0.6, rgb(255, 255, 0)},
+        {0.75, rgb(255, 30, 0)},
+        {1, rgb(50, 0, 0)}}},
+      {"gpJet",
+       false,
+       {{0, rgb(0, 0, 100)},
+        {0.15, rgb(0, 50, 255)},
+        {0.35, rgb(0, 255, 255)},
+        {0.65, rgb(255, 255, 0)},
+        {0.85, rgb(255, 30, 0)},
+        {1, rgb(100, 0, 0)}}},
+      {"gpHues",
+       true,
+       {{0, rgb(255, 0, 0)},
+        {1.0 / 3.0, rgb(0, 0, 255)},
+        {2.0 / 3.0, rgb(0, 255, 0)},
+        {1, rgb(255, 0, 0)}}},
+  };
+  return presets;
+}
+
+ColorLut::ColorLut(std::vector<uint32_t> colors, bool periodic)
+    : colors_(std::move(colors)), periodic_(periodic) {}
+
+ColorLut ColorLut::FromStops(const std::vector<ColorStop> &unsorted,
+                             int levels, bool hsv, bool periodic) {
+  levels = std::max(levels, 2);
+  std::vector<ColorStop> stops = unsorted;
+  std::stable_sort(stops.begin(), stops.end(),
+                   [](const ColorStop &a, const ColorStop &b) {
+                     return a.position < b.position;
+                   });
+  std::vector<uint32_t> colors(levels, rgb(0, 0, 0));
+  if (stops.size() == 1) {
+    std::fill(colors.begin(), colors.end(), stops[0].rgb | 0xff000000u);
+  }
+  if (stops.size() < 2) return ColorLut(std::move(colors), periodic);
+
+  const double indexToPosFactor = 1.0 / (levels - 1);
+  for (int i = 0; i < levels; ++i) {
+    const double position = i * indexToPosFactor;
+    auto high = std::lower_bound(
+        stops.begin(), stops.end(), position,
+        [](const ColorStop &s, double p) { return s.position < p; });
+    if (high == stops.end()) {
+      colors[i] = std::prev(high)->rgb | 0xff000000u;
+      continue;
+    }
+    if (high == stops.begin()) {
+      colors[i] = high->rgb | 0xff000000u;
+      continue;
+    }
+    const auto low = std::prev(high);
+    const double t =
+        (position - low->position) / (high->position - low->position);
+    if (!hsv) {
+      auto mix = [t](uint32_t a, uint32_t b, int shift) {
+        return static_cast<int>((1 - t) * ((a >> shift) & 0xff) +
+                                t * ((b >> shift) & 0xff));
+      };
+      colors[i] = rgb(mix(low->rgb, high->rgb, 16),
+                      mix(low->rgb, high->rgb, 8), mix(low->rgb, high->rgb, 0));
+      continue;
+    }
+    const Hsv a = toHsv(low->rgb);
+    const Hsv b = toHsv(high->rgb);
+    double hue = 0;
+    const double hueDiff = b.h - a.h;
+    if (hueDiff > 0.5) {
+      hue = a.h - t * (1.0 - hueDiff);
+    } else if (hueDiff < -0.5) {
+      hue = a.h + t * (1.0 + hueDiff);
+    } else {
+      hue = a.h + t * hueDiff;
+    }
+    if (hue < 0) {
+      hue += 1.0;
+    } else if (hue >= 1.0) {
+      hue -= 1.0;
+    }
+    colors[i] = fromHsv(hue, (1 - t) * a.s + t * b.s, (1 - t) * a.v + t * b.v);
+  }
+  return ColorLut(std::move(colors), periodic);
+}
+
+ColorLut ColorLut::FromPreset(const std::string &name, int levels,
+                              bool periodic) {
+  for (const auto &preset : colorPresets()) {
+    if (name == preset.name) {
+      return FromStops(preset.stops, levels, preset.hsv, periodic);
+    }
+  }
+  return {};
+}
+
+void ColorLut::colorize(const double *data, double lower, double upper,
+                        uint32_t *out, int n, int dataIndexFactor,
+                        bool logarithmic) const {
+  const int levels = levelCount();
+  if (levels == 0) return;
+  kernels().colorize(data, dataIndexFactor, lower, upper, colors_.data(),
+                     levels, periodic_, logarithmic, out, n);
+}
+
+uint32_t ColorLut::color(double position, double lower, double upper,
+                         bool logarithmic) const {
+  const int levels = levelCount();
+  if (levels == 0) return 0;
+  int index = 0;
+  if (!logarithmic) {
+    index = (position - lower) * (levels - 1) / (upper - lower);
+  } else {
+    index = std::log(position / lower) / std::log(upper / lower) * (levels - 1);
+  }
+  if (periodic_) {
+    index = index % levels;
+    if (index < 0) index += levels;
+  } else {
+    index = std::clamp(index, 0, levels - 1);
+  }
+  return colors_[index];
+}
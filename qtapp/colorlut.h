@@ -0,0 +1,54 @@
+#ifndef COLORLUT_H
+#define COLORLUT_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Colors are 0xAARRGGBB, the QRgb layout.
+struct ColorStop {
+  double position;  // in [0, 1]
+  uint32_t rgb;
+};
+
+struct ColorPreset {
+  const char *name;
+  bool hsv;  // interpolation in HSV instead of RGB
+  std::vector<ColorStop> stops;
+};
+
+// The gradient presets, in ColorMapper::GradientPreset order.
+const std::vector<ColorPreset> &colorPresets();
+
+// Qt-free lookup table mapping data values to colors, with the same index
+// math as ColorMapper. It is immutable once built, so it can be shared by any
+// number of threads.
+class ColorLut {
+ public:
+  ColorLut() = default;
+  ColorLut(std::vector<uint32_t> colors, bool periodic);
+
+  // Same interpolation as ColorMapper for opaque stops, HSV included.
+  static ColorLut FromStops(const std::vector<ColorStop> &stops, int levels,
+                            bool hsv, bool periodic);
+  // Empty when there is no preset with that name.
+  static ColorLut FromPreset(const std::string &name, int levels = 350,
+                             bool periodic = false);
+
+  bool empty() const { return colors_.empty(); }
+  int levelCount() const { return static_cast<int>(colors_.size()); }
+  bool periodic() const { return periodic_; }
+  void setPeriodic(bool enabled) { periodic_ = enabled; }
+  const std::vector<uint32_t> &colors() const { return colors_; }
+
+  void colorize(const double *data, double lower, double upper, uint32_t *out,
+                int n, int dataIndexFactor = 1,
+                bool logarithmic = false) const;
+  uint32_t color(double position, double lower, double upper,
+                 bool logarithmic = false) const;
+
+ private:
+  std::vector<uint32_t> colors_;
+  bool periodic_ = false;
+};
+
+#endif  // COLORLUT_H
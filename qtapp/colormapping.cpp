@@ -55,13 +55,14 @@ void ColorMapper::setColorInterpolation(
   }
 }
 
-void ColorMapper::setPeriodic(bool enabled) { mPeriodic = enabled; }
+void ColorMapper::setPeriodic(bool enabled) {
+  mPeriodic = enabled;
+  mLut.setPeriodic(enabled);
+}
 
 void ColorMapper::colorize(const double *data, const double &lower,
                            const double &upper, QRgb *scanLine, int n,
                            int dataIndexFactor, bool logarithmic) {
-  // If you change something here, make sure to also adapt color() and the other
-  // colorize() overload
   if (!data) {
     qDebug() << Q_FUNC_INFO << "null pointer given as data";
     return;
@@ -71,58 +72,14 @@ void ColorMapper::colorize(const double *data, const double &lower,
     return;
   }
   if (mColorBufferInvalidated) updateColorBuffer();
-
-  const double range_size = upper - lower;
-  if (!logarithmic) {
-    const double posToIndexFactor = (mLevelCount - 1) / range_size;
-    if (mPeriodic) {
-      for (int i = 0; i < n; ++i) {
-        int index =
-            (int)((data[dataIndexFactor * i] - lower) * posToIndexFactor) %
-            mLevelCount;
-        if (index < 0) index += mLevelCount;
-        scanLine[i] = mColorBuffer.at(index);
-      }
-    } else {
-      for (int i = 0; i < n; ++i) {
-        int index = (data[dataIndexFactor * i] - lower) * posToIndexFactor;
-        if (index < 0)
-          index = 0;
-        else if (index >= mLevelCount)
-          index = mLevelCount - 1;
-        scanLine[i] = mColorBuffer.at(index);
-      }
-    }
-  } else  // logarithmic == true
-  {
-    if (mPeriodic) {
-      for (int i = 0; i < n; ++i) {
-        int index = (int)(qLn(data[dataIndexFactor * i] / lower) /
-                          qLn(upper / lower) * (mLevelCount - 1)) %
-                    mLevelCount;
-        if (index < 0) index += mLevelCount;
-        scanLine[i] = mColorBuffer.at(index);
-      }
-    } else {
-      for (int i = 0; i < n; ++i) {
-        int index = qLn(data[dataIndexFactor * i] / lower) /
-                    qLn(upper / lower) * (mLevelCount - 1);
-        if (index < 0)
-          index = 0;
-        else if (index >= mLevelCount)
-          index = mLevelCount - 1;
-        scanLine[i] = mColorBuffer.at(index);
-      }
-    }
-  }
+  mLut.colorize(data, lower, upper, scanLine, n, dataIndexFactor, logarithmic);
 }
 
 void ColorMapper::colorize(const double *data, const unsigned char *alpha,
                            const double &lower, const double &upper,
                            QRgb *scanLine, int n, int dataIndexFactor,
                            bool logarithmic) {
-  // If you change something here, make sure to also adapt color() and the other
-  // colorize() overload
+  // If you change something here, make sure to also adapt ColorLut::colorize()
   if (!data) {
     qDebug() << Q_FUNC_INFO << "null pointer given as data";
     return;
@@ -212,129 +169,34 @@ void ColorMapper::colorize(const double *data, const unsigned char *alpha,
 
 QRgb ColorMapper::color(double position, const double &lower,
                         const double &upper, bool logarithmic) {
-  // If you change something here, make sure to also adapt ::colorize()
   if (mColorBufferInvalidated) updateColorBuffer();
-  const double range_size = upper - lower;
-  int index = 0;
-  if (!logarithmic)
-    index = (position - lower) * (mLevelCount - 1) / range_size;
-  else
-    index = qLn(position / lower) / qLn(upper / lower) * (mLevelCount - 1);
-  if (mPeriodic) {
-    index = index % mLevelCount;
-    if (index < 0) index += mLevelCount;
-  } else {
-    if (index < 0)
-      index = 0;
-    else if (index >= mLevelCount)
-      index = mLevelCount - 1;
-  }
-  return mColorBuffer.at(index);
+  return mLut.color(position, lower, upper, logarithmic);
+}
+
+const ColorLut &ColorMapper::lut() {
+  if (mColorBufferInvalidated) updateColorBuffer();
+  return mLut;
 }
 
 void ColorMapper::loadPreset(GradientPreset preset) {
   clearColorStops();
-  switch (preset) {
-    case gpGrayscale:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, Qt::black);
-      setColorStopAt(1, Qt::white);
-      break;
-    case gpHot:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(50, 0, 0));
-      setColorStopAt(0.2, QColor(180, 10, 0));
-      setColorStopAt(0.4, QColor(245, 50, 0));
-      setColorStopAt(0.6, QColor(255, 150, 10));
-      setColorStopAt(0.8, QColor(255, 255, 50));
-      setColorStopAt(1, QColor(255, 255, 255));
-      break;
-    case gpCold:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(0, 0, 50));
-      setColorStopAt(0.2, QColor(0, 10, 180));
-      setColorStopAt(0.4, QColor(0, 50, 245));
-      setColorStopAt(0.6, QColor(10, 150, 255));
-      setColorStopAt(0.8, QColor(50, 255, 255));
-      setColorStopAt(1, QColor(255, 255, 255));
-      break;
-    case gpNight:
-      setColorInterpolation(ciHSV);
-      setColorStopAt(0, QColor(10, 20, 30));
-      setColorStopAt(1, QColor(250, 255, 250));
-      break;
-    case gpCandy:
-      setColorInterpolation(ciHSV);
-      setColorStopAt(0, QColor(0, 0, 255));
-      setColorStopAt(1, QColor(255, 250, 250));
-      break;
-    case gpGeography:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(70, 170, 210));
-      setColorStopAt(0.20, QColor(90, 160, 180));
-      setColorStopAt(0.25, QColor(45, 130, 175));
-      setColorStopAt(0.30, QColor(100, 140, 125));
-      setColorStopAt(0.5, QColor(100, 140, 100));
-      setColorStopAt(0.6, QColor(130, 145, 120));
-      setColorStopAt(0.7, QColor(140, 130, 120));
-      setColorStopAt(0.9, QColor(180, 190, 190));
-      setColorStopAt(1, QColor(210, 210, 230));
-      break;
-    case gpIon:
-      setColorInterpolation(ciHSV);
-      setColorStopAt(0, QColor(50, 10, 10));
-      setColorStopAt(0.45, QColor(0, 0, 255));
-      setColorStopAt(0.8, QColor(0, 255, 255));
-      setColorStopAt(1, QColor(0, 255, 0));
-      break;
-    case gpThermal:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(0, 0, 50));
-      setColorStopAt(0.15, QColor(20, 0, 120));
-      setColorStopAt(0.33, QColor(200, 30, 140));
-      setColorStopAt(0.6, QColor(255, 100, 0));
-      setColorStopAt(0.85, QColor(255, 255, 40));
-      setColorStopAt(1, QColor(255, 255, 255));
-      break;
-    case gpPolar:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(50, 255, 255));
-      setColorStopAt(0.18, QColor(10, 70, 255));
-      setColorStopAt(0.28, QColor(10, 10, 190));
-      setColorStopAt(0.5, QColor(0, 0, 0));
-      setColorStopAt(0.72, QColor(190, 10, 10));
-      setColorStopAt(0.82, QColor(255, 70, 10));
-      setColorStopAt(1, QColor(255, 255, 50));
-      break;
-    case gpSpectrum:
-      setColorInterpolation(ciHSV);
-      setColorStopAt(0, QColor(50, 0, 50));
-      setColorStopAt(0.15, QColor(0, 0, 255));
-      setColorStopAt(0.35, QColor(0, 255, 255));
-      setColorStopAt(0.6, QColor(255, 255, 0));
-      setColorStopAt(0.75, QColor(255, 30, 0));
-      setColorStopAt(1, QColor(50, 0, 0));
-      break;
-    case gpJet:
-      setColorInterpolation(ciRGB);
-      setColorStopAt(0, QColor(0, 0, 100));
-      setColorStopAt(0.15, QColor(0, 50, 255));
-      setColorStopAt(0.35, QColor(0, 255, 255));
-      setColorStopAt(0.65, QColor(255, 255, 0));
-      setColorStopAt(0.85, QColor(255, 30, 0));
-      setColorStopAt(1, QColor(100, 0, 0));
-      break;
-    case gpHues:
-      setColorInterpolation(ciHSV);
-      setColorStopAt(0, QColor(255, 0, 0));
-      setColorStopAt(1.0 / 3.0, QColor(0, 0, 255));
-      setColorStopAt(2.0 / 3.0, QColor(0, 255, 0));
-      setColorStopAt(1, QColor(255, 0, 0));
-      break;
+  const ColorPreset &gradient = colorPresets()[preset];
+  setColorInterpolation(gradient.hsv ? ciHSV : ciRGB);
+  for (const ColorStop &stop : gradient.stops) {
+    setColorStopAt(stop.position, QColor(stop.rgb));
   }
   mPreset = preset;
 }
 
+QMap<QString, ColorMapper::GradientPreset> ColorMapper::presetNames() {
+  QMap<QString, GradientPreset> names;
+  const auto &presets = colorPresets();
+  for (size_t i = 0; i < presets.size(); ++i) {
+    names[presets[i].name] = static_cast<GradientPreset>(i);
+  }
+  return names;
+}
+
 void ColorMapper::clearColorStops() {
   mColorStops.clear();
   mColorBufferInvalidated = true;
@@ -471,5 +333,6 @@ void ColorMapper::updateColorBuffer() {
   {
     mColorBuffer.fill(qRgb(0, 0, 0));
   }
+  mLut = ColorLut({mColorBuffer.begin(), mColorBuffer.end()}, mPeriodic);
   mColorBufferInvalidated = false;
 }
@@ -3,8 +3,11 @@
 #include <QColor>
 #include <QMap>
 #include <QRgb>
+#include <QString>
 #include <QVector>
 
+#include "colorlut.h"
+
 class ColorMapper {
  public:
   enum ColorInterpolation { ciRGB, ciHSV };
@@ -52,6 +55,9 @@ class ColorMapper {
   QRgb color(double position, const double &lower, const double &upper,
              bool logarithmic = false);
   void loadPreset(GradientPreset preset);
+  static QMap<QString, GradientPreset> presetNames();
+  // The current colors, for code that does not depend on Qt.
+  const ColorLut &lut();
   void clearColorStops();
   ColorMapper inverted() const;
 
@@ -67,6 +73,7 @@ class ColorMapper {
       mColorBuffer;  // have colors premultiplied with alpha (for usage
                      // with QImage::Format_ARGB32_Premultiplied)
   bool mColorBufferInvalidated;
+  ColorLut mLut;  // mColorBuffer, does the mapping of colorize() and color()
 
   // non-virtual methods:
   bool stopsUseAlpha() const;
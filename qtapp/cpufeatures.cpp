@@ -0,0 +1,81 @@
+#include "cpufeatures.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+const char *const kNames[] = {"sse2", "avx2", "avx512"};
+
+std::atomic<int> active{-1};
+// -1 where the family uses the active build.
+std::atomic<int> family_isa[5] = {-1, -1, -1, -1, -1};
+
+}  // namespace
+
+const char *isaName(Isa isa) { return kNames[static_cast<int>(isa)]; }
+
+bool parseIsa(const std::string &name, Isa *isa) {
+  for (int i = 0; i < 3; ++i) {
+    if (name == kNames[i]) {
+      *isa = static_cast<Isa>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+Isa detectedIsa() {
+#ifdef FRACTALGEN_ISA_VARIANTS
+  // Also checks that the OS saves the vector registers.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512vl")) {
+    return Isa::Avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return Isa::Avx2;
+  }
+#endif
+  return Isa::Sse2;
+}
+
+Isa activeIsa() {
+  int isa = active.load(std::memory_order_relaxed);
+  if (isa >= 0) return static_cast<Isa>(isa);
+  Isa selected = detectedIsa();
+  if (const char *env = std::getenv("FRACTALGEN_ISA")) {
+    Isa wanted;
+    if (!parseIsa(env, &wanted)) {
+      std::fprintf(stderr, "FRACTALGEN_ISA: unknown instruction set '%s'\n",
+                   env);
+    } else if (wanted > selected) {
+      std::fprintf(stderr, "FRACTALGEN_ISA: this CPU can not run %s\n", env);
+    } else {
+      selected = wanted;
+    }
+  }
+  // Another thread may have set it meanwhile.
+  isa = -1;
+  active.compare_exchange_strong(isa, static_cast<int>(selected));
+  return static_cast<Isa>(active.load(std::memory_order_relaxed));
+}
+
+bool setIsa(Isa isa) {
+  if (isa > detectedIsa()) return false;
+  active = static_cast<int>(isa);
+  for (auto &family : family_isa) family = -1;
+  return true;
+}
+
+Isa familyIsa(int family) {
+  const int isa = family_isa[family].load(std::memory_order_relaxed);
+  return isa >= 0 ? static_cast<Isa>(isa) : activeIsa();
+}
+
+bool setFamilyIsa(int family, Isa isa) {
+  if (isa > detectedIsa()) return false;
+  family_isa[family] = static_cast<int>(isa);
+  return true;
+}
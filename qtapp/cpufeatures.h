@@ -0,0 +1,29 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+#include <string>
+
+// The instruction sets the hot kernels are built for, see kernels.h. Sse2 is
+// the baseline build, the only one outside x86-64.
+enum class Isa { Sse2 = 0, Avx2 = 1, Avx512 = 2 };
+
+const char *isaName(Isa isa);
+// "sse2", "avx2" or "avx512".
+bool parseIsa(const std::string &name, Isa *isa);
+
+// The best build this CPU and OS can run.
+Isa detectedIsa();
+// The build the kernels use: detectedIsa(), unless set by setIsa() or the
+// FRACTALGEN_ISA environment variable.
+Isa activeIsa();
+// Selects the build of the kernels, for testing and comparisons, and drops
+// the builds set per family. Returns false, keeping the current one, when this
+// CPU can not run it.
+bool setIsa(Isa isa);
+
+// The build the escape time kernels of a family (0 to 4) use: activeIsa(),
+// unless the tuning (autotune.h) found another one faster.
+Isa familyIsa(int family);
+// Returns false, keeping the current one, when this CPU can not run it.
+bool setFamilyIsa(int family, Isa isa);
+
+#endif  // CPUFEATURES_H
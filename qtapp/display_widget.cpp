@@ -2,11 +2,15 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include <QDebug>
 #include <QGesture>
 #include <QKeyEvent>
 #include <QPainter>
 
+#include "trace.h"
+
 const double DefaultCenterX = -0.637011;
 const double DefaultCenterY = -0.0395159;
 const double DefaultScale = 0.00403897;
@@ -19,6 +23,7 @@ QPixmap DisplayWidget::ImageData::GenPixmap(ColorMapper &cmap, bool useLog,
                                             bool calc_bound, double offset) {
   if (data.empty()) return {};
   if (calc_bound) {
+    TRACE_SCOPE("min/max");
     minVal = std::numeric_limits<double>::max();
     maxVal = std::numeric_limits<double>::min();
     for (const auto &v : std::as_const(data)) {
@@ -31,10 +36,15 @@ QPixmap DisplayWidget::ImageData::GenPixmap(ColorMapper &cmap, bool useLog,
   int dim = size.width();
 
   const double o = (maxVal - minVal) * offset;
-  for (int i = 0; i < image.height(); ++i) {
-    cmap.colorize(data.data() + i * dim, minVal + o, maxVal + o,
-                  reinterpret_cast<QRgb *>(image.scanLine(i)), dim, 1, useLog);
+  {
+    TRACE_SCOPE("colorize");
+    for (int i = 0; i < image.height(); ++i) {
+      cmap.colorize(data.data() + i * dim, minVal + o, maxVal + o,
+                    reinterpret_cast<QRgb *>(image.scanLine(i)), dim, 1,
+                    useLog);
+    }
   }
+  TRACE_SCOPE("fromImage");
   return QPixmap::fromImage(image);
 }
 
@@ -46,6 +56,10 @@ DisplayWidget::DisplayWidget(QWidget *parent)
       curScale(DefaultScale) {
   connect(&thread, &RenderThread::renderedImage, this,
           &DisplayWidget::updatePixmap);
+  // The stats cross threads by value, Qt 5 has to know the type first.
+  qRegisterMetaType<RenderStats>("RenderStats");
+  connect(&thread, &RenderThread::renderedStats, this,
+          &DisplayWidget::updateStats);
 #if QT_CONFIG(cursor)
   setCursor(Qt::CrossCursor);
 #endif
@@ -54,7 +68,7 @@ DisplayWidget::DisplayWidget(QWidget *parent)
   setLogScale(false);
   help =
       tr("Zoom with mouse wheel, +/- keys or pinch.  Scroll with arrow keys "
-         "or by dragging.");
+         "or by dragging.  S: render statistics, H: cost map.");
 }
 
 void DisplayWidget::Reset() {
@@ -93,21 +107,25 @@ void DisplayWidget::setColorMapOffset(const double &offset) {
 }
 
 void DisplayWidget::paintEvent(QPaintEvent * /* event */) {
+  TRACE_SCOPE("paint");
   QPainter painter(this);
   painter.fillRect(rect(), Qt::black);
-  if (pixmap.isNull()) {
+  const QPixmap &shown =
+      costView != cvNone && !costPixmap.isNull() ? costPixmap : pixmap;
+  if (shown.isNull()) {
     painter.setPen(Qt::white);
     painter.drawText(rect(), Qt::AlignCenter | Qt::TextWordWrap,
                      tr("Rendering initial image, please wait..."));
+    emit framePainted(false);
     return;
   }
   if (qFuzzyCompare(curScale, pixmapScale)) {
-    painter.drawPixmap(pixmapOffset, pixmap);
+    painter.drawPixmap(pixmapOffset, shown);
   } else {
-    auto previewPixmap = qFuzzyCompare(pixmap.devicePixelRatio(), qreal(1))
-                             ? pixmap
-                             : pixmap.scaled(pixmap.size(), Qt::KeepAspectRatio,
-                                             Qt::SmoothTransformation);
+    auto previewPixmap = qFuzzyCompare(shown.devicePixelRatio(), qreal(1))
+                             ? shown
+                             : shown.scaled(shown.size(), Qt::KeepAspectRatio,
+                                            Qt::SmoothTransformation);
     double scaleFactor = pixmapScale / curScale;
     int newWidth = int(previewPixmap.width() * scaleFactor);
     int newHeight = int(previewPixmap.height() * scaleFactor);
@@ -124,8 +142,9 @@ void DisplayWidget::paintEvent(QPaintEvent * /* event */) {
   }
 
   QFontMetrics metrics = painter.fontMetrics();
-  if (!info.isEmpty()) {
-    int infoWidth = metrics.horizontalAdvance(info);
+  const QString &top = info.isEmpty() ? statsInfo : info;
+  if (!top.isEmpty()) {
+    int infoWidth = metrics.horizontalAdvance(top);
     int infoHeight = metrics.height();
 
     painter.setPen(Qt::NoPen);
@@ -136,7 +155,7 @@ void DisplayWidget::paintEvent(QPaintEvent * /* event */) {
 
     painter.setPen(Qt::white);
     painter.drawText(rect(), Qt::AlignHCenter | Qt::AlignTop | Qt::TextWordWrap,
-                     info);
+                     top);
   }
 
   int helpWidth = metrics.horizontalAdvance(help);
@@ -151,6 +170,7 @@ void DisplayWidget::paintEvent(QPaintEvent * /* event */) {
   painter.setPen(Qt::white);
   painter.drawText(rect(),
                    Qt::AlignHCenter | Qt::AlignBottom | Qt::TextWordWrap, help);
+  emit framePainted(info.isEmpty());
 }
 
 void DisplayWidget::resizeEvent(QResizeEvent * /* event */) { RenderCommand(); }
@@ -178,6 +198,19 @@ void DisplayWidget::keyPressEvent(QKeyEvent *event) {
     case Qt::Key_Q:
       close();
       break;
+    case Qt::Key_S:
+      setShowStats(!showStats);
+      break;
+    case Qt::Key_H:
+      // Image, iterations per pixel, time per tile.
+      costView = static_cast<CostView>((costView + 1) % 3);
+      if (!showStats && costView != cvNone) {
+        setShowStats(true);
+      } else {
+        updateCostPixmap();
+        update();
+      }
+      break;
     default:
       QWidget::keyPressEvent(event);
   }
@@ -217,6 +250,8 @@ void DisplayWidget::mouseReleaseEvent(QMouseEvent *event) {
 
 void DisplayWidget::updatePixmap(const QVector<double> &data, const QSize &size,
                                  double scaleFactor) {
+  auto &tracer = Tracer::instance();
+  if (tracer.enabled()) tracer.complete("deliver", thread.emittedAt());
   if (!lastDragPos.isNull()) return;
   imgData.data = data;
   imgData.size = size;
@@ -228,6 +263,58 @@ void DisplayWidget::updatePixmap(const QVector<double> &data, const QSize &size,
   update();
 }
 
+void DisplayWidget::updateStats(const RenderStats &renderStats) {
+  if (!lastDragPos.isNull() || !showStats) return;
+  stats = renderStats;
+  const double slowest =
+      stats.tile_ms.empty()
+          ? 0.0
+          : *std::max_element(stats.tile_ms.begin(), stats.tile_ms.end());
+  const double perPixel =
+      stats.total_iterations /
+      std::max(static_cast<double>(stats.size.width()) * stats.size.height(),
+               1.0);
+  statsInfo = QString(
+                  "%1 ms, %2 Mpx/s, %3 Mit (%4 it/px), %5% at max iterations, "
+                  "slowest %6x%6 tile %7 ms")
+                  .arg(stats.seconds * 1e3, 0, 'f', 1)
+                  .arg(stats.pixels_per_second / 1e6, 0, 'f', 2)
+                  .arg(stats.total_iterations / 1e6, 0, 'f', 1)
+                  .arg(perPixel, 0, 'f', 1)
+                  .arg(stats.max_iter_share * 100, 0, 'f', 1)
+                  .arg(stats.tile_size)
+                  .arg(slowest, 0, 'f', 2);
+  updateCostPixmap();
+}
+
+void DisplayWidget::setShowStats(bool enable) {
+  showStats = enable;
+  thread.setCollectStats(enable);
+  if (!enable) {
+    costView = cvNone;
+    stats = RenderStats();
+    statsInfo.clear();
+    costPixmap = QPixmap();
+    update();
+    return;
+  }
+  RenderCommand();
+}
+
+void DisplayWidget::updateCostPixmap() {
+  costPixmap = QPixmap();
+  if (costView == cvIterations && !stats.iterations.empty()) {
+    ImageData cost{stats.iterations, stats.size};
+    costPixmap = cost.GenPixmap(costMapper, false);
+  } else if (costView == cvTileTime && !stats.tile_ms.empty()) {
+    ImageData cost{stats.tile_ms, stats.tiles};
+    costPixmap = cost.GenPixmap(costMapper, false)
+                     .scaled(stats.tiles * stats.tile_size,
+                             Qt::IgnoreAspectRatio, Qt::FastTransformation)
+                     .copy(QRect(QPoint(), stats.size));
+  }
+}
+
 void DisplayWidget::zoom(double zoomFactor) {
   curScale *= zoomFactor;
   RenderCommand();
@@ -239,7 +326,8 @@ void DisplayWidget::RenderCommand() {
   fractalParams.centerX = centerX;
   fractalParams.centerY = centerY;
   fractalParams.scale = curScale;
-  fractalParams.image_size = size();
+  fractalParams.image_width = width();
+  fractalParams.image_height = height();
   thread.render(fractalParams);  // centerX, centerY, curScale, size(),
                                  // devicePixelRatio());
 }
@@ -11,6 +11,8 @@
 class DisplayWidget : public QWidget {
   Q_OBJECT
   friend class MainWindow;
+  friend class LatencyHarness;
+  enum CostView { cvNone, cvIterations, cvTileTime };
   struct ImageData {
     QVector<double> data;
     QSize size;
@@ -45,15 +47,21 @@ class DisplayWidget : public QWidget {
   double y2() const { return centerY + height() * curScale; }
   ColorMapper *colorMap() { return &colorMapper; }
   bool useLogScale() const { return useLog; }
-  bool colorOffset() const { return colorMapOffset; }
+  double colorOffset() const { return colorMapOffset; }
 
 #ifndef QT_NO_GESTURES
   bool event(QEvent *event) override;
 #endif
 
+ signals:
+  // After every paint. `complete` when it shows the rendered image of the
+  // current view, not the preview of a previous one.
+  void framePainted(bool complete);
+
  private slots:
   void updatePixmap(const QVector<double> &data, const QSize &size,
                     double scaleFactor);
+  void updateStats(const RenderStats &renderStats);
   void zoom(double zoomFactor);
 
  private:
@@ -63,6 +71,8 @@ class DisplayWidget : public QWidget {
 #endif
   void RenderCommand();
   void colorize();
+  void setShowStats(bool enable);
+  void updateCostPixmap();
   RenderThread thread;
   QPixmap pixmap;
   QPoint pixmapOffset;
@@ -76,6 +86,12 @@ class DisplayWidget : public QWidget {
   bool useLog{false};
   QString help, info;
   double colorMapOffset{0.0};
+  bool showStats{false};
+  CostView costView{cvNone};
+  RenderStats stats;
+  QString statsInfo;
+  QPixmap costPixmap;  // replaces the image when costView != cvNone
+  ColorMapper costMapper{ColorMapper::gpThermal};
 };
 //! [0]
 
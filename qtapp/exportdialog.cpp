@@ -1,70 +1,34 @@
-#include <execution>
 #include "exportdialog.h"
 
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMessageBox>
+#include <QVector>
+#include <algorithm>
 
+#include "imagewriter.h"
 #include "ui_exportdialog.h"
 
 namespace {
 
-void applyLowPassFilter(std::vector<double> &input, int R, int C) {
-  constexpr double gaussianKernel5x5[5][5] = {
-      {1.0 / 273, 4.0 / 273, 7.0 / 273, 4.0 / 273, 1.0 / 273},
-      {4.0 / 273, 16.0 / 273, 26.0 / 273, 16.0 / 273, 4.0 / 273},
-      {7.0 / 273, 26.0 / 273, 41.0 / 273, 26.0 / 273, 7.0 / 273},
-      {4.0 / 273, 16.0 / 273, 26.0 / 273, 16.0 / 273, 4.0 / 273},
-      {1.0 / 273, 4.0 / 273, 7.0 / 273, 4.0 / 273, 1.0 / 273}};
-
-  std::vector<double> output(input.size());
-
-  auto getValue = [&](int r, int c) -> double {
-    // if (r < 0 || r >= R || c < 0 || c >= C) return 0;
-    r = std::max(0, std::min(R - 1, r));  // Mirror border handling
-    c = std::max(0, std::min(C - 1, c));
-    return input[r * C + c];
-  };
+QString formatDuration(double seconds) {
+  if (seconds < 60) return QString("%1 s").arg(seconds, 0, 'f', 1);
+  if (seconds < 3600) return QString("%1 min").arg(seconds / 60, 0, 'f', 1);
+  return QString("%1 h").arg(seconds / 3600, 0, 'f', 1);
+}
 
-  std::for_each(
-      std::execution::par_unseq, std::begin(output), std::end(output),
-      [&](double &out) {
-        int idx = &out - &output[0];  // Get index from pointer arithmetic
-        int r = idx / C;
-        int c = idx % C;
-        double sum = 0.0;
-        for (int kr = -2; kr <= 2; ++kr) {
-          for (int kc = -2; kc <= 2; ++kc) {
-            sum += getValue(r + kr, c + kc) * gaussianKernel5x5[kr + 1][kc + 1];
-          }
-        }
-        out = sum;
-      });
-  input.swap(output);
-}
-
-std::vector<double> genRawData(const FractalParameters *params, const int H,
-                               const int W, const double x0, const double x1,
-                               const double y0, const double y1, bool smoth) {
-  auto fractal = Fractal::Create(params);
-  auto funct =
-      fractal->GetCouloringFunction(params->mandelbrot, params->orbit_trap);
-
-  std::vector<int> indexs(H);
-  std::iota(indexs.begin(), indexs.end(), 0);
-  const dbltype dx = (x1 - x0) / (W - 1);
-  const dbltype dy = (y1 - y0) / (H - 1);
-  std::vector<double> data(W * H);
-  std::for_each(std::execution::par_unseq, indexs.begin(), indexs.end(),
-                [&](int i) {
-                  double *d = &(data[i * W]);
-                  dbltype yy = y0 + i * dy;
-                  for (int k = 0; k < W; ++k) {
-                    d[k] = funct({x0 + k * dx, yy});
-                  }
-                });
-  if (smoth) {
-    applyLowPassFilter(data, H, W);
+// "0 0.25 0.5" -> {0, 0.25, 0.5}, empty for none, repeated ones once, as
+// they would write the same file. False on a bad number.
+bool parseOffsets(const QString &text, QVector<double> *offsets) {
+  offsets->clear();
+  for (const QString &word : text.split(' ', Qt::SkipEmptyParts)) {
+    bool ok = false;
+    const double o = word.toDouble(&ok);
+    if (!ok) return false;
+    if (!offsets->contains(o)) offsets->push_back(o);
   }
-  return std::move(data);
+  return true;
 }
 
 }  // namespace
@@ -72,6 +36,15 @@ std::vector<double> genRawData(const FractalParameters *params, const int H,
 ExportDialog::ExportDialog(QWidget *parent, FractalParameters *p)
     : QDialog(parent), params(p), ui(new Ui::ExportDialog) {
   ui->setupUi(this);
+  ui->checkBoxViewRange->setEnabled(false);
+  // The options start editable only when their checkbox is on.
+  ui->spinBoxSmoothRadius->setEnabled(ui->checkBoxSmoth->isChecked());
+  ui->spinBoxSsaa->setEnabled(ui->checkBoxSsaa->isChecked());
+  ui->doubleSpinBoxRelief->setEnabled(ui->checkBoxRelief->isChecked());
+  for (const QString &name : ColorMapper::presetNames().keys()) {
+    auto *item = new QListWidgetItem(name, ui->listWidgetVariants);
+    item->setCheckState(Qt::Unchecked);
+  }
 }
 
 void ExportDialog::setBBox(const double &x1, const double &x2, const double &y1,
@@ -89,6 +62,13 @@ void ExportDialog::setColorMapParameters(ColorMapper *colorMapper, bool useLog,
   this->offset = offset;
 }
 
+void ExportDialog::setValueRange(double minVal, double maxVal) {
+  viewMinVal = minVal;
+  viewMaxVal = maxVal;
+  hasViewRange = true;
+  ui->checkBoxViewRange->setEnabled(true);
+}
+
 double ExportDialog::x1() const { return ui->leX1->text().toDouble(); }
 double ExportDialog::x2() const { return ui->leX2->text().toDouble(); }
 double ExportDialog::y1() const { return ui->leY1->text().toDouble(); }
@@ -100,6 +80,36 @@ void ExportDialog::setBBoxSize(const QSize &size) {
   aspectRatio = static_cast<double>(size.height()) / size.width();
 }
 
+ExportSettings ExportDialog::exportSettings() const {
+  ExportSettings s;
+  s.W = ui->spinBoxW->value();
+  s.H = ui->spinBoxH->value();
+  s.x0 = x1();
+  s.x1 = x2();
+  s.y0 = y1();
+  s.y1 = y2();
+  s.ssaa = ssaa();
+  s.smooth_radius = smoothRadius();
+  s.relief = ui->checkBoxRelief->isChecked();
+  s.light.exaggeration = ui->doubleSpinBoxRelief->value();
+  return s;
+}
+
+int ExportDialog::smoothRadius() const {
+  return ui->checkBoxSmoth->isChecked() ? ui->spinBoxSmoothRadius->value() : 0;
+}
+
+int ExportDialog::ssaa() const {
+  return ui->checkBoxSsaa->isChecked() ? ui->spinBoxSsaa->value() : 0;
+}
+
+std::optional<std::pair<double, double>> ExportDialog::viewRange() const {
+  if (hasViewRange && ui->checkBoxViewRange->isChecked()) {
+    return std::make_pair(viewMinVal, viewMaxVal);
+  }
+  return std::nullopt;
+}
+
 QSize ExportDialog::bboxSize() const {
   return QSize{ui->spinBoxW->value(), ui->spinBoxH->value()};
 }
@@ -116,20 +126,13 @@ void ExportDialog::on_pushButton_clicked() {
   const QString fname = QFileDialog::getSaveFileName(this, "Save file");
   if (fname.isEmpty()) return;
 
-  ui->pushButton->setText("Wait");
-
-  const int W = ui->spinBoxW->value();
-  const int H = ui->spinBoxH->value();
-  std::vector<double> data = genRawData(params, H, W, x1(), x2(), y1(), y2(),
-                                        ui->checkBoxSmoth->isChecked());
-
-  QFile ofile(fname);
-  ofile.open(QIODevice::WriteOnly);
-
-  int header[2] = {W, H};
-  ofile.write(reinterpret_cast<char *>(header), 2 * sizeof(int));
-  ofile.write(reinterpret_cast<char *>(data.data()),
-              sizeof(double) * data.size());
+  // Streamed and journaled, an interrupted export of the same job continues
+  // where it stopped.
+  jobName = fname;
+  job = [p = *params, s = exportSettings(),
+         f = fname.toStdString()](const ExportProgress &progress) {
+    return exportRawStrips(&p, s, f, progress);
+  };
   accept();
 }
 
@@ -137,28 +140,170 @@ void ExportDialog::on_checkBox_clicked(bool checked) {
   ui->spinBoxH->setEnabled(!checked);
 }
 
+void ExportDialog::on_checkBoxSmoth_clicked(bool checked) {
+  ui->spinBoxSmoothRadius->setEnabled(checked);
+}
+
+void ExportDialog::on_checkBoxSsaa_clicked(bool checked) {
+  ui->spinBoxSsaa->setEnabled(checked);
+}
+
+void ExportDialog::on_checkBoxRelief_clicked(bool checked) {
+  ui->doubleSpinBoxRelief->setEnabled(checked);
+}
+
 void ExportDialog::on_pushButtonImage_clicked() {
-  const QString fname = QFileDialog::getSaveFileName(this, "Save file");
+  const QString fname = QFileDialog::getSaveFileName(
+      this, "Save file", {},
+      "PNG (*.png);;BigTIFF (*.tif *.tiff);;PPM (*.ppm);;"
+      "Images (*.jpg *.bmp)");
+  if (fname.isEmpty()) return;
+
+  jobName = fname;
+  const ExportSettings s = exportSettings();
+  if (StripImageWriter::isSupported(fname.toStdString())) {
+    // Streamed, so the image size is not limited by the available memory.
+    std::vector<ColorVariant> variants(1);
+    variants[0].lut = colorMapper->lut();
+    variants[0].useLog = useLog;
+    variants[0].offset = offset;
+    variants[0].fname = fname.toStdString();
+    job = [p = *params, s, variants, range = viewRange()](
+              const ExportProgress &progress) mutable {
+      const auto [minVal, maxVal] = range ? *range : estimateRange(&p, s);
+      return exportColorStrips(&p, s, variants, minVal, maxVal, progress);
+    };
+    accept();
+    return;
+  }
+
+  job = [p = *params, s, lut = colorMapper->lut(), useLog = useLog,
+         offset = offset, range = viewRange(),
+         fname](const ExportProgress &progress) mutable {
+    const int W = s.W;
+    const int H = s.H;
+    QImage image({W, H}, QImage::Format_ARGB32);
+    if (canFuseColorize(s)) {
+      const auto [minVal, maxVal] = range ? *range : estimateRange(&p, s);
+      const double o = (maxVal - minVal) * offset;
+      renderColorRows(&p, s, 0, H, lut, minVal + o, maxVal + o, useLog,
+                      reinterpret_cast<uint32_t *>(image.bits()),
+                      image.bytesPerLine() / sizeof(uint32_t));
+    } else {
+      const std::vector<double> data = genRawData(&p, s);
+      if (!range) {
+        const auto &&mm = std::minmax_element(data.begin(), data.end());
+        range = std::make_pair(*(mm.first), *(mm.second));
+      }
+      const auto [minVal, maxVal] = *range;
+      const double o = (maxVal - minVal) * offset;
+      for (int i = 0; i < H; ++i) {
+        lut.colorize(data.data() + static_cast<size_t>(i) * W, minVal + o,
+                     maxVal + o,
+                     reinterpret_cast<uint32_t *>(image.scanLine(i)), W, 1,
+                     useLog);
+      }
+      if (s.relief) {
+        const auto shade =
+            shadeRange(s, data, 0, H, 0, H, useLog, minVal + o);
+        shadeRows(s, data, 0, H, 0, H, useLog, minVal + o, shade,
+                  reinterpret_cast<uint32_t *>(image.bits()));
+      }
+    }
+    progress(H, H);
+    return image.save(fname);
+  };
+  accept();
+}
+
+void ExportDialog::on_pushButtonVariants_clicked() {
+  const QString fname = QFileDialog::getSaveFileName(
+      this, "Save variants", {},
+      "PNG (*.png);;BigTIFF (*.tif *.tiff);;PPM (*.ppm)");
   if (fname.isEmpty()) return;
+  if (!StripImageWriter::isSupported(fname.toStdString())) {
+    QMessageBox::warning(this, "Export", "Unsupported format: " + fname);
+    return;
+  }
+
+  QVector<double> offsets;
+  if (!parseOffsets(ui->lineEditVariantsOffsets->text(), &offsets)) {
+    QMessageBox::warning(this, "Export",
+                         "Bad offsets: " + ui->lineEditVariantsOffsets->text());
+    return;
+  }
+  // Without a list, the offset of the view and no suffix for it.
+  const bool offsetSuffix = !offsets.empty();
+  if (offsets.empty()) offsets.push_back(offset);
 
-  ui->pushButton->setText("Wait");
-
-  const int W = ui->spinBoxW->value();
-  const int H = ui->spinBoxH->value();
-  const std::vector<double> data = genRawData(
-      params, H, W, x1(), x2(), y1(), y2(), ui->checkBoxSmoth->isChecked());
-
-  const auto &&mm =
-      std::minmax_element(std::execution::par_unseq, data.begin(), data.end());
-  const double minVal = *(mm.first);
-  const double maxVal = *(mm.second);
-  const double o = (maxVal - minVal) * offset;
-  QImage image({W, H}, QImage::Format_ARGB32);
-  for (int i = 0; i < H; ++i) {
-    colorMapper->colorize(data.data() + i * W, minVal + o, maxVal + o,
-                          reinterpret_cast<QRgb *>(image.scanLine(i)), W, 1,
-                          useLog);
+  // <name>_<colormap>[_log][_o<offset>].<ext> for every checked colormap,
+  // scale and offset.
+  const QFileInfo info(fname);
+  const QString base = info.path() + "/" + info.completeBaseName();
+  const auto presets = ColorMapper::presetNames();
+  std::vector<ColorVariant> variants;
+  for (int i = 0; i < ui->listWidgetVariants->count(); ++i) {
+    const QListWidgetItem *item = ui->listWidgetVariants->item(i);
+    if (item->checkState() != Qt::Checked) continue;
+    for (const bool log : {false, true}) {
+      if (!(log ? ui->checkBoxVariantsLog : ui->checkBoxVariantsLinear)
+               ->isChecked())
+        continue;
+      for (const double o : offsets) {
+        ColorVariant v;
+        ColorMapper cmap(presets[item->text()]);
+        cmap.setPeriodic(colorMapper->periodic());
+        v.lut = cmap.lut();
+        v.useLog = log;
+        v.offset = o;
+        v.fname = QString("%1_%2%3%4.%5")
+                      .arg(base, item->text(), log ? "_log" : "",
+                           offsetSuffix ? "_o" + QString::number(o) : "",
+                           info.suffix())
+                      .toStdString();
+        variants.push_back(std::move(v));
+      }
+    }
   }
-  bool ok = image.save(fname);
+  if (variants.empty()) return;
+
+  jobName = fname;
+  job = [p = *params, s = exportSettings(), variants, range = viewRange()](
+            const ExportProgress &progress) mutable {
+    const auto [minVal, maxVal] = range ? *range : estimateRange(&p, s);
+    return exportColorStrips(&p, s, variants, minVal, maxVal, progress);
+  };
   accept();
 }
+
+void ExportDialog::on_pushButtonEstimate_clicked() {
+  QVector<double> offsets;
+  if (!parseOffsets(ui->lineEditVariantsOffsets->text(), &offsets)) {
+    offsets.clear();
+  }
+  int variants = 0;
+  for (int i = 0; i < ui->listWidgetVariants->count(); ++i) {
+    if (ui->listWidgetVariants->item(i)->checkState() == Qt::Checked) {
+      variants += ui->checkBoxVariantsLinear->isChecked() +
+                  ui->checkBoxVariantsLog->isChecked();
+    }
+  }
+  variants *= std::max<int>(offsets.size(), 1);
+
+  // Streamed single image export, or the variants when some are selected.
+  const ExportEstimate e =
+      estimateExport(params, exportSettings(), std::max(variants, 1), true);
+  const QLocale locale;
+  QString text = QString("%1, %2 it/px, %3 Mpx/s")
+                     .arg(formatDuration(e.seconds))
+                     .arg(e.iterations_per_pixel, 0, 'f', 0)
+                     .arg(e.pixels_per_second * 1e-6, 0, 'f', 2);
+  if (e.ssaa_fraction > 0) {
+    text += QString(", SSAA on %1%").arg(e.ssaa_fraction * 100, 0, 'f', 1);
+  }
+  text += QString("\nMemory %1, raw %2, image up to %3")
+              .arg(locale.formattedDataSize(e.peak_memory),
+                   locale.formattedDataSize(e.raw_bytes),
+                   locale.formattedDataSize(e.rgb_bytes));
+  ui->labelEstimate->setText(text);
+}
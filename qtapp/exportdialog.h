@@ -2,9 +2,12 @@
 #define EXPORTDIALOG_H
 
 #include <QDialog>
+#include <optional>
 
 #include "fractals.h"
 #include "colormapping.h"
+#include "exporter.h"
+#include "exportjob.h"
 
 namespace Ui {
 class ExportDialog;
@@ -25,7 +28,17 @@ class ExportDialog : public QDialog {
 
   void setColorMapParameters(ColorMapper *colorMapper, bool useLog, double offset);
   void setBBoxSize(const QSize &size);
+  void setValueRange(double minVal, double maxVal);
   QSize bboxSize() const;
+  ExportSettings exportSettings() const;
+  int smoothRadius() const;
+  int ssaa() const;
+  // The range of the displayed data when the export should use it.
+  std::optional<std::pair<double, double>> viewRange() const;
+  // The export chosen by the user, empty when the dialog was closed without
+  // exporting. It works on copies of the parameters and runs in background.
+  const ExportJob::Job &exportJob() const { return job; }
+  const QString &exportName() const { return jobName; }
 
  private slots:
   void on_spinBoxW_valueChanged(int arg1);
@@ -35,6 +48,16 @@ class ExportDialog : public QDialog {
 
   void on_pushButtonImage_clicked();
 
+  void on_checkBoxSmoth_clicked(bool checked);
+
+  void on_checkBoxSsaa_clicked(bool checked);
+
+  void on_pushButtonVariants_clicked();
+
+  void on_checkBoxRelief_clicked(bool checked);
+
+  void on_pushButtonEstimate_clicked();
+
   private:
   Ui::ExportDialog *ui;
   double aspectRatio{1.0};
@@ -42,6 +65,10 @@ class ExportDialog : public QDialog {
   ColorMapper *colorMapper;
   bool useLog;
   double offset;
+  bool hasViewRange{false};
+  double viewMinVal, viewMaxVal;
+  ExportJob::Job job;
+  QString jobName;
 };
 
 #endif  // EXPORTDIALOG_H
@@ -0,0 +1,596 @@
+#include "exporter.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+#include "autotune.h"
+#include "exportjournal.h"
+#include "filters.h"
+#include "imagewriter.h"
+#include "renderscheduler.h"
+#include "supersampling.h"
+#include "trace.h"
+
+namespace {
+
+constexpr double kSsaaThreshold = 0.01;  // fraction of the data range
+constexpr int kRangeSamples = 512;
+constexpr size_t kStripPixels = 1 << 22;
+constexpr int kFusedTile = 256;
+constexpr int kEstimateGrain = 64;  // samples per scheduler tile
+constexpr int kReliefBands = 256;
+// Strips of runStripPipeline() in memory at once: computed, colorized and
+// written.
+constexpr int kPipelineStrips = 3;
+// RGB rows plus their deflated chunks while a PNG strip is written, the
+// other formats only keep the RGB rows.
+constexpr double kWriterBytesPerPixel = 6.0;
+
+int stripRows(const ExportSettings &s) {
+  return static_cast<int>(std::clamp<size_t>(kStripPixels / s.W, 1, s.H));
+}
+
+// Everything the output of an export depends on, the journal key is its hash.
+std::string jobDescription(const FractalParameters *params,
+                           const ExportSettings &s) {
+  std::ostringstream out;
+  out.precision(17);
+  out << params->fractal_family << " " << params->n << " "
+      << params->max_iterations << " " << params->max_norm << " " << params->c
+      << " " << params->q << " " << params->orbit_pt << " "
+      << params->mandelbrot << " " << params->orbit_trap << " "
+      << params->orbit_mode << "|" << s.W << " " << s.H << " " << s.x0 << " "
+      << s.x1 << " " << s.y0 << " " << s.y1 << " " << s.ssaa << " "
+      << s.smooth_radius << " " << s.relief << " " << s.light.azimuth << " "
+      << s.light.altitude << " " << s.light.exaggeration;
+  return out.str();
+}
+
+std::string jobDescription(const std::vector<ColorVariant> &variants) {
+  std::ostringstream out;
+  out.precision(17);
+  for (const auto &v : variants) {
+    out << "|" << v.fname << " " << v.useLog << " " << v.offset << " "
+        << v.lut.levelCount() << " " << v.lut.periodic();
+    for (uint32_t color : v.lut.colors()) out << " " << color;
+  }
+  return out.str();
+}
+
+// A strip travelling through the export pipeline.
+struct Strip {
+  int row0 = 0;
+  int rows = 0;
+  std::vector<double> data;
+  std::vector<std::vector<uint32_t>> images;
+};
+
+// Computes strip k on the calling thread while strip k - 1 is colorized and
+// strip k - 2 is written, each stage on its own thread, so the wall time
+// tends to the one of the slowest stage instead of their sum. At most
+// kPipelineStrips strips are in memory. Writes happen one at a time and in order.
+bool runStripPipeline(const ExportSettings &s, int row0,
+                      const std::function<Strip(int, int)> &compute,
+                      const std::function<void(Strip &)> &colorize,
+                      const std::function<bool(const Strip &)> &write,
+                      const ExportProgress &progress) {
+  std::future<Strip> coloring;
+  std::future<bool> writing;
+  int written = row0;
+  int writing_rows = 0;
+
+  auto finishWrite = [&]() {
+    if (!writing.valid()) return true;
+    if (!writing.get()) return false;
+    written += writing_rows;
+    return !progress || progress(written, s.H);
+  };
+  auto startWrite = [&]() {
+    Strip strip = coloring.get();
+    if (!finishWrite()) return false;
+    writing_rows = strip.rows;
+    writing = std::async(
+        std::launch::async,
+        [&write](const Strip &strip) {
+          TRACE_SCOPE("write strip");
+          return write(strip);
+        },
+        std::move(strip));
+    return true;
+  };
+
+  const int strip = stripRows(s);
+  for (int r = row0; r < s.H; r += strip) {
+    Strip computed;
+    {
+      TRACE_SCOPE("compute strip");
+      computed = compute(r, std::min(strip, s.H - r));
+    }
+    // The futures of std::async wait in their destructor, nothing outlives
+    // an early return.
+    if (coloring.valid() && !startWrite()) return false;
+    coloring = std::async(
+        std::launch::async,
+        [&colorize](Strip strip) {
+          TRACE_SCOPE("colorize strip");
+          colorize(strip);
+          return strip;
+        },
+        std::move(computed));
+  }
+  if (coloring.valid() && !startWrite()) return false;
+  return finishWrite();
+}
+
+// The floor keeps the log finite: escape counts of 0 would give -inf. Below
+// the color range the colors stop changing too.
+std::vector<double> logField(const ExportSettings &s,
+                             const std::vector<double> &data, int n,
+                             double lower) {
+  const double floor =
+      lower > 0.0 ? lower : std::numeric_limits<double>::min();
+  std::vector<double> z(data.size());
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, n, [&](int i) {
+        const size_t begin = static_cast<size_t>(i) * s.W;
+        for (size_t k = begin; k < begin + s.W; ++k) {
+          z[k] = std::log(std::max(data[k], floor));
+        }
+      });
+  return z;
+}
+
+// The intensity range of the relief of every variant, over kReliefBands
+// rows spread over the image. plot.py stretches the one of the whole image,
+// which the strips can not wait for. The rows are rendered with their
+// neighbours at the export resolution, so that the slopes are those of the
+// strips, with the same data `range` for the supersampling.
+std::vector<std::pair<double, double>> estimateShadeRanges(
+    const FractalParameters *params, const ExportSettings &s, double range,
+    const std::vector<ColorVariant> &variants,
+    const std::vector<std::pair<double, double>> &bounds) {
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  const int bands = std::min(s.H, kReliefBands);
+  std::vector<std::vector<std::pair<double, double>>> band_ranges(bands);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, bands, [&](int b) {
+        const int row = static_cast<int>((2 * b + 1) *
+                                         static_cast<int64_t>(s.H) /
+                                         (2 * bands));
+        const int first = std::max(0, row - 1);
+        const int n = std::min(s.H, row + 2) - first;
+        const std::vector<double> data =
+            renderRows(params, s, first, n, range);
+        for (size_t v = 0; v < variants.size(); ++v) {
+          band_ranges[b].push_back(shadeRange(s, data, first, n, row, 1,
+                                              variants[v].useLog,
+                                              bounds[v].first));
+        }
+      });
+  std::vector<std::pair<double, double>> ranges(variants.size(),
+                                                {kInf, -kInf});
+  for (const auto &band : band_ranges) {
+    for (size_t v = 0; v < ranges.size(); ++v) {
+      ranges[v] = {std::min(ranges[v].first, band[v].first),
+                   std::max(ranges[v].second, band[v].second)};
+    }
+  }
+  return ranges;
+}
+
+}  // namespace
+
+std::vector<double> renderRows(const FractalParameters *params,
+                               const ExportSettings &s, int row0, int rows,
+                               double range) {
+  const int W = s.W;
+  const int halo = s.smooth_radius + (s.ssaa > 1 ? 1 : 0);
+  const int first = std::max(0, row0 - halo);
+  const int last = std::min(s.H, row0 + rows + halo);
+  const int n = last - first;
+
+  auto fractal = Fractal::Create(params);
+  if (!fractal) return std::vector<double>(static_cast<size_t>(rows) * W);
+  auto funct =
+      fractal->GetCouloringFunction(params->mandelbrot, params->orbit_trap);
+
+  const dbltype dx = (s.x1 - s.x0) / (W - 1);
+  const dbltype dy = (s.y1 - s.y0) / (s.H - 1);
+  // The pages are placed when first written, so the rows are bound to the
+  // NUMA node that computes them before resize() zeroes them.
+  std::vector<double> data;
+  data.reserve(static_cast<size_t>(n) * W);
+  RenderScheduler::instance().bindRows(data.data(), sizeof(double) * W, first,
+                                       last);
+  data.resize(static_cast<size_t>(n) * W);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, first, last, [&](int i) {
+        double *d = &(data[static_cast<size_t>(i - first) * W]);
+        fractal->EvaluateSpan(params->mandelbrot, params->orbit_trap, s.x0, dx,
+                              0, W, s.y0 + i * dy, d);
+      },
+      tunedGrain(params->fractal_family));
+
+  if (s.ssaa > 1) {
+    if (range <= 0.0) {
+      const auto mm = std::minmax_element(data.begin(), data.end());
+      range = *mm.second - *mm.first;
+    }
+    adaptiveSupersample(data, n, W, first, s.x0, dx, s.y0, dy, funct, s.ssaa,
+                        range * kSsaaThreshold);
+  }
+  if (s.smooth_radius > 0) {
+    applyLowPassFilter(data, n, W, s.smooth_radius);
+  }
+  if (n != rows) {
+    data.erase(data.begin() + static_cast<size_t>(row0 - first + rows) * W,
+               data.end());
+    data.erase(data.begin(),
+               data.begin() + static_cast<size_t>(row0 - first) * W);
+  }
+  return data;
+}
+
+std::vector<double> genRawData(const FractalParameters *params,
+                               const ExportSettings &s) {
+  return renderRows(params, s, 0, s.H);
+}
+
+std::pair<double, double> estimateRange(const FractalParameters *params,
+                                        const ExportSettings &s) {
+  auto fractal = Fractal::Create(params);
+  if (!fractal) return {0.0, 0.0};
+
+  const int W = std::min(s.W, kRangeSamples);
+  const int H = std::min(s.H, kRangeSamples);
+  const dbltype dx = W > 1 ? (s.x1 - s.x0) / (W - 1) : 0.0;
+  const dbltype dy = H > 1 ? (s.y1 - s.y0) / (H - 1) : 0.0;
+  std::vector<double> data(static_cast<size_t>(W) * H);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, H, [&](int i) {
+        double *d = &(data[static_cast<size_t>(i) * W]);
+        fractal->EvaluateSpan(params->mandelbrot, params->orbit_trap, s.x0, dx,
+                              0, W, s.y0 + i * dy, d);
+      },
+      tunedGrain(params->fractal_family));
+  const auto mm = std::minmax_element(data.begin(), data.end());
+  return {*mm.first, *mm.second};
+}
+
+bool canFuseColorize(const ExportSettings &s) {
+  return s.ssaa < 2 && s.smooth_radius <= 0 && !s.relief;
+}
+
+void renderColorRows(const FractalParameters *params, const ExportSettings &s,
+                     int row0, int rows, const ColorLut &lut, double lower,
+                     double upper, bool useLog, uint32_t *image,
+                     size_t stride) {
+  auto fractal = Fractal::Create(params);
+  if (!fractal) return;
+
+  const int W = s.W;
+  const dbltype dx = (s.x1 - s.x0) / (W - 1);
+  const dbltype dy = (s.y1 - s.y0) / (s.H - 1);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, row0, row0 + rows, [&](int i) {
+        uint32_t *line = image + static_cast<size_t>(i - row0) * stride;
+        const dbltype yy = s.y0 + i * dy;
+        double tile[kFusedTile];
+        for (int k0 = 0; k0 < W; k0 += kFusedTile) {
+          const int n = std::min(kFusedTile, W - k0);
+          fractal->EvaluateSpan(params->mandelbrot, params->orbit_trap, s.x0,
+                                dx, k0, n, yy, tile);
+          lut.colorize(tile, lower, upper, line + k0, n, 1, useLog);
+        }
+      },
+      tunedGrain(params->fractal_family));
+}
+
+void shadeRows(const ExportSettings &s, const std::vector<double> &data,
+               int first, int n, int row0, int rows, bool useLog,
+               double lower, std::pair<double, double> range,
+               uint32_t *image) {
+  if (!useLog) {
+    shadeRelief(data.data(), first, n, s.W, row0, rows, 1.0, s.light, range,
+                image);
+    return;
+  }
+  const std::vector<double> z = logField(s, data, n, lower);
+  shadeRelief(z.data(), first, n, s.W, row0, rows, 1.0, s.light, range, image);
+}
+
+std::pair<double, double> shadeRange(const ExportSettings &s,
+                                     const std::vector<double> &data,
+                                     int first, int n, int row0, int rows,
+                                     bool useLog, double lower) {
+  if (!useLog) {
+    return reliefRange(data.data(), first, n, s.W, row0, rows, 1.0, s.light);
+  }
+  const std::vector<double> z = logField(s, data, n, lower);
+  return reliefRange(z.data(), first, n, s.W, row0, rows, 1.0, s.light);
+}
+
+bool exportColorStrips(const FractalParameters *params,
+                       const ExportSettings &s,
+                       std::vector<ColorVariant> &variants, double minVal,
+                       double maxVal, const ExportProgress &progress) {
+  const size_t nvariants = variants.size();
+  if (nvariants == 0) return true;
+  if (!Fractal::Create(params)) return false;
+  // The range is not part of the key: it may come from the view, which is
+  // gone after a restart. A resumed export keeps the range it started with.
+  std::ostringstream range;
+  range.precision(17);
+  range << minVal << " " << maxVal;
+  ExportJournal journal(
+      variants[0].fname + ".journal",
+      journalKey(jobDescription(params, s) + jobDescription(variants)),
+      range.str());
+
+  std::vector<std::unique_ptr<StripImageWriter>> writers;
+  std::vector<std::pair<double, double>> bounds;
+  const auto &resume = journal.resumeState();
+  std::istringstream stored(journal.data());
+  double storedMin = 0.0, storedMax = 0.0;
+  if (resume.size() == nvariants && stored >> storedMin >> storedMax) {
+    for (size_t v = 0; v < nvariants; ++v) {
+      writers.push_back(
+          StripImageWriter::Resume(variants[v].fname, s.W, s.H, resume[v]));
+      if (!writers.back() || resume[v].rows != resume[0].rows) {
+        writers.clear();
+        break;
+      }
+    }
+  }
+  if (!writers.empty()) {
+    minVal = storedMin;
+    maxVal = storedMax;
+  } else {
+    if (!resume.empty()) journal.restart(range.str());
+    for (const auto &v : variants) {
+      writers.push_back(StripImageWriter::Create(v.fname, s.W, s.H));
+      if (!writers.back()) return false;
+    }
+  }
+  for (auto &v : variants) {
+    const double o = (maxVal - minVal) * v.offset;
+    bounds.emplace_back(minVal + o, maxVal + o);
+  }
+  const std::vector<std::pair<double, double>> shades =
+      s.relief ? estimateShadeRanges(params, s, maxVal - minVal, variants,
+                                     bounds)
+               : std::vector<std::pair<double, double>>();
+
+  const int W = s.W;
+  const bool fused = nvariants == 1 && canFuseColorize(s);
+  auto compute = [&](int row0, int rows) {
+    Strip strip;
+    strip.row0 = row0;
+    strip.rows = rows;
+    if (fused) {
+      strip.images.emplace_back(static_cast<size_t>(rows) * W);
+      renderColorRows(params, s, row0, rows, variants[0].lut,
+                      bounds[0].first, bounds[0].second, variants[0].useLog,
+                      strip.images[0].data(), W);
+    } else {
+      // The relief needs the rows above and below the strip.
+      const int first = s.relief ? std::max(0, row0 - 1) : row0;
+      const int last = s.relief ? std::min(s.H, row0 + rows + 1) : row0 + rows;
+      strip.data = renderRows(params, s, first, last - first, maxVal - minVal);
+    }
+    return strip;
+  };
+  auto colorize = [&](Strip &strip) {
+    if (fused) return;
+    const int rows = strip.rows;
+    const int first = s.relief ? std::max(0, strip.row0 - 1) : strip.row0;
+    const int n = static_cast<int>(strip.data.size() / W);
+    const double *d =
+        strip.data.data() + static_cast<size_t>(strip.row0 - first) * W;
+    strip.images.resize(nvariants);
+    for (auto &image : strip.images) {
+      image.resize(static_cast<size_t>(rows) * W);
+    }
+    // Every (variant, row) pair is an independent task.
+    RenderScheduler::instance().parallelFor(
+        RenderPriority::Export, 0, static_cast<int>(nvariants) * rows,
+        [&](int task) {
+          const int v = task / rows;
+          const size_t begin = static_cast<size_t>(task % rows) * W;
+          variants[v].lut.colorize(d + begin, bounds[v].first,
+                                   bounds[v].second,
+                                   strip.images[v].data() + begin, W, 1,
+                                   variants[v].useLog);
+        });
+    if (s.relief) {
+      for (size_t v = 0; v < nvariants; ++v) {
+        shadeRows(s, strip.data, first, n, strip.row0, rows,
+                  variants[v].useLog, bounds[v].first, shades[v],
+                  strip.images[v].data());
+      }
+    }
+  };
+  std::vector<ExportJournal::Checkpoint> checkpoints(nvariants);
+  auto write = [&](const Strip &strip) {
+    for (size_t v = 0; v < nvariants; ++v) {
+      if (!writers[v]->writeRows(strip.images[v].data(), strip.rows)) {
+        return false;
+      }
+      checkpoints[v] = writers[v]->checkpoint();
+    }
+    journal.commit(checkpoints);
+    return true;
+  };
+  if (!runStripPipeline(s, writers[0]->rowsWritten(), compute, colorize,
+                        write, progress)) {
+    return false;
+  }
+
+  bool ok = true;
+  for (auto &writer : writers) ok = writer->close() && ok;
+  if (ok) journal.finish();
+  return ok;
+}
+
+bool exportRawStrips(const FractalParameters *params, const ExportSettings &s,
+                     const std::string &fname,
+                     const ExportProgress &progress) {
+  if (!Fractal::Create(params)) return false;
+  ExportJournal journal(fname + ".journal",
+                        journalKey("raw|" + jobDescription(params, s)));
+  const int W = s.W;
+  const size_t row_bytes = sizeof(double) * W;
+  const int header[2] = {W, s.H};
+
+  std::ofstream ofile;
+  int row0 = 0;
+  const auto &resume = journal.resumeState();
+  if (resume.size() == 1) {
+    std::error_code ec;
+    const uint64_t expected = sizeof(header) + resume[0].rows * row_bytes;
+    if (resume[0].bytes == expected &&
+        std::filesystem::file_size(fname, ec) >= expected && !ec) {
+      std::filesystem::resize_file(fname, expected, ec);
+      ofile.open(fname, std::ios::binary | std::ios::in | std::ios::out);
+      ofile.seekp(0, std::ios::end);
+      row0 = resume[0].rows;
+    }
+  }
+  if (!ofile.is_open()) {
+    ofile.open(fname, std::ios::binary | std::ios::trunc);
+    ofile.write(reinterpret_cast<const char *>(header), sizeof(header));
+    row0 = 0;
+  }
+  if (!ofile) return false;
+
+  auto compute = [&](int row0, int rows) {
+    Strip strip;
+    strip.row0 = row0;
+    strip.rows = rows;
+    strip.data = renderRows(params, s, row0, rows);
+    return strip;
+  };
+  auto write = [&](const Strip &strip) {
+    ofile.write(reinterpret_cast<const char *>(strip.data.data()),
+                sizeof(double) * strip.data.size());
+    ofile.flush();
+    if (!ofile) return false;
+    ExportJournal::Checkpoint cp;
+    cp.rows = strip.row0 + strip.rows;
+    cp.bytes = static_cast<uint64_t>(ofile.tellp());
+    journal.commit({cp});
+    return true;
+  };
+  if (!runStripPipeline(s, row0, compute, [](Strip &) {}, write, progress)) {
+    return false;
+  }
+  ofile.close();
+  if (ofile.fail()) return false;
+  journal.finish();
+  return true;
+}
+
+ExportEstimate estimateExport(const FractalParameters *params,
+                              const ExportSettings &s, int variants,
+                              bool streamed, int samples) {
+  auto fractal = Fractal::Create(params);
+  if (!fractal) return {};
+  auto funct =
+      fractal->GetCouloringFunction(params->mandelbrot, params->orbit_trap);
+  auto escape = fractal->GetCouloringFunction(params->mandelbrot, 0);
+
+  const int W = s.W;
+  const int H = s.H;
+  const dbltype dx = W > 1 ? (s.x1 - s.x0) / (W - 1) : 0.0;
+  const dbltype dy = H > 1 ? (s.y1 - s.y0) / (H - 1) : 0.0;
+  std::mt19937_64 rng(W * 31 + H);
+  std::uniform_int_distribution<int> col(0, std::max(W - 2, 0));
+  std::uniform_int_distribution<int> row(0, std::max(H - 2, 0));
+  std::vector<std::pair<int, int>> pixels(samples);
+  for (auto &p : pixels) p = {row(rng), col(rng)};
+
+  // Timed pass with the export coloring function.
+  std::vector<std::array<double, 3>> values(samples);
+  const auto start = std::chrono::steady_clock::now();
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, samples,
+      [&](int j) {
+        auto &v = values[j];
+        const dbltype x = s.x0 + pixels[j].second * dx;
+        const dbltype y = s.y0 + pixels[j].first * dy;
+        v[0] = funct({x, y});
+        v[1] = funct({x + dx, y});
+        v[2] = funct({x, y + dy});
+      },
+      kEstimateGrain);
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  // The escape loops break on the same conditions as the final norm ones, so
+  // their value is the number of iterations in both modes.
+  std::vector<double> counts(samples);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, samples,
+      [&](int j) {
+        counts[j] =
+            escape({s.x0 + pixels[j].second * dx, s.y0 + pixels[j].first * dy});
+      },
+      kEstimateGrain);
+  const double iterations = std::accumulate(counts.begin(), counts.end(), 0.0);
+
+  ExportEstimate e{};
+  const double pixels_count = static_cast<double>(W) * H;
+  e.pixels_per_second = 3.0 * samples / std::max(elapsed, 1e-9);
+  e.iterations_per_pixel = iterations / samples;
+
+  double minVal = std::numeric_limits<double>::max();
+  double maxVal = std::numeric_limits<double>::lowest();
+  for (const auto &v : values) {
+    for (double d : v) {
+      minVal = std::min(minVal, d);
+      maxVal = std::max(maxVal, d);
+    }
+  }
+  const double th = (maxVal - minVal) * kSsaaThreshold;
+  const auto edges = std::count_if(
+      values.begin(), values.end(), [th](const std::array<double, 3> &v) {
+        return std::abs(v[0] - v[1]) > th || std::abs(v[0] - v[2]) > th;
+      });
+  e.ssaa_fraction = s.ssaa > 1 ? static_cast<double>(edges) / samples : 0.0;
+
+  const double samples_per_pixel = 1.0 + e.ssaa_fraction * s.ssaa * s.ssaa;
+  e.seconds = pixels_count * samples_per_pixel / e.pixels_per_second;
+
+  // Data buffer and one ARGB image per variant, plus the filter output and
+  // the SSAA mask while computing, for the whole image. Streamed, the
+  // pipeline holds kPipelineStrips strips, only the computed one with the
+  // compute buffers, and the writers hold the strip being written.
+  const int images = std::max(variants, 1);
+  const bool data = !streamed || !canFuseColorize(s);
+  const double strip_bytes = 4.0 * images + (data ? sizeof(double) : 0);
+  const double compute_bytes =
+      data ? (s.smooth_radius > 0 ? sizeof(double) : 0) + (s.ssaa > 1 ? 1 : 0)
+           : 0;
+  double bytes;
+  if (streamed) {
+    const double strip_pixels = static_cast<double>(stripRows(s)) * W;
+    bytes = strip_pixels * (kPipelineStrips * strip_bytes + compute_bytes +
+                            kWriterBytesPerPixel * images);
+  } else {
+    bytes = pixels_count * (strip_bytes + compute_bytes);
+  }
+  e.peak_memory = static_cast<size_t>(bytes);
+  e.raw_bytes = 2 * sizeof(int) + sizeof(double) * W * static_cast<size_t>(H);
+  e.rgb_bytes = 3 * static_cast<size_t>(W) * H;
+  return e;
+}
@@ -0,0 +1,113 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "colorlut.h"
+#include "fractals.h"
+#include "relief.h"
+
+struct ExportSettings {
+  int W, H;
+  double x0, x1, y0, y1;
+  int ssaa = 0;           // NxN adaptive supersampling, < 2 disables it
+  int smooth_radius = 0;  // gaussian smoothing, 0 disables it
+  bool relief = false;    // hillshade of the (log) data over the colors
+  ReliefSettings light;
+};
+
+// Renders the rows [row0, row0 + rows) of the export, including supersampling
+// and smoothing. The neighbour rows those need are rendered as well, so
+// consecutive calls give exactly the same data as a single one. `range` is the
+// data range the SSAA threshold refers to, <= 0 takes it from the rows. The
+// rows are 0 for a family Fractal::Create() does not know, like the other
+// functions give 0 or nothing; the exports return false for it.
+std::vector<double> renderRows(const FractalParameters *params,
+                               const ExportSettings &s, int row0, int rows,
+                               double range = 0.0);
+std::vector<double> genRawData(const FractalParameters *params,
+                               const ExportSettings &s);
+
+// Min/max of the data over a low resolution grid covering the export bbox.
+std::pair<double, double> estimateRange(const FractalParameters *params,
+                                        const ExportSettings &s);
+
+// True when rows can be colorized as they are computed, i.e. there is no
+// processing that needs the raw data of the neighbour pixels.
+bool canFuseColorize(const ExportSettings &s);
+
+// Computes and colorizes the rows [row0, row0 + rows) into `image` (one row
+// every `stride` pixels) without the intermediate double buffer: every tile
+// is mapped through the color LUT while it is still in cache. Requires
+// canFuseColorize(s).
+void renderColorRows(const FractalParameters *params, const ExportSettings &s,
+                     int row0, int rows, const ColorLut &lut, double lower,
+                     double upper, bool useLog, uint32_t *image,
+                     size_t stride);
+
+// One colored output of an export. The colors span [minVal, maxVal] of the
+// export shifted by `offset` times the range.
+struct ColorVariant {
+  ColorLut lut;
+  bool useLog = false;
+  double offset = 0.0;
+  std::string fname;  // must be supported by StripImageWriter
+};
+
+// Overlays the relief shading of `data` (rows [first, first + n)) on the
+// colored rows [row0, row0 + rows) of `image`, taking the log of the data
+// first when `useLog`, floored at `lower`, the bottom of the color range.
+// The intensity is stretched from `range`, see shadeRelief().
+void shadeRows(const ExportSettings &s, const std::vector<double> &data,
+               int first, int n, int row0, int rows, bool useLog,
+               double lower, std::pair<double, double> range,
+               uint32_t *image);
+// The intensity range of shadeRows() over the rows [row0, row0 + rows), the
+// whole image for the range plot.py stretches.
+std::pair<double, double> shadeRange(const ExportSettings &s,
+                                     const std::vector<double> &data,
+                                     int first, int n, int row0, int rows,
+                                     bool useLog, double lower);
+
+// Called from the exporting thread after every written strip with the number
+// of rows done and the image height. Returning false cancels the export, the
+// journal is kept so the same job resumes later.
+using ExportProgress = std::function<bool(int done, int total)>;
+
+// Renders the image strip by strip, so the memory used does not depend on the
+// image height, and writes every strip in all the variants. The fractal is
+// computed only once whatever the number of variants. Compute, colorize and
+// write work on consecutive strips at the same time. Progress is journaled
+// next to the first file, so an interrupted export of the same job resumes
+// from the last finished strip.
+bool exportColorStrips(const FractalParameters *params,
+                       const ExportSettings &s,
+                       std::vector<ColorVariant> &variants, double minVal,
+                       double maxVal, const ExportProgress &progress = {});
+
+struct ExportEstimate {
+  double seconds;               // wall time of the computation
+  double iterations_per_pixel;  // escape iterations, whatever the coloring
+  double pixels_per_second;
+  double ssaa_fraction;         // share of pixels re-sampled by SSAA
+  size_t peak_memory;           // bytes, streamed or in memory export
+  size_t raw_bytes;             // size of a raw export
+  size_t rgb_bytes;             // size of an uncompressed RGB image
+};
+
+// Predicts the cost of an export from a sparse random sample of its pixels,
+// each one rendered together with its right and bottom neighbours to also
+// estimate how many pixels SSAA will re-sample.
+ExportEstimate estimateExport(const FractalParameters *params,
+                              const ExportSettings &s, int variants,
+                              bool streamed, int samples = 4096);
+
+// Raw export (two ints W, H followed by the doubles row by row), streamed and
+// resumable like exportColorStrips().
+bool exportRawStrips(const FractalParameters *params, const ExportSettings &s,
+                     const std::string &fname,
+                     const ExportProgress &progress = {});
+
+#endif  // EXPORTER_H
@@ -0,0 +1,19 @@
+#include "exportjob.h"
+
+ExportJob::ExportJob(const QString &name, Job job, QObject *parent)
+    : QThread(parent), name_(name), job_(std::move(job)) {}
+
+ExportJob::~ExportJob() {
+  cancel();
+  wait();
+}
+
+void ExportJob::cancel() { cancelled_ = true; }
+
+void ExportJob::run() {
+  const bool ok = job_([this](int done, int total) {
+    emit progress(done, total);
+    return !cancelled_;
+  });
+  emit done(ok);
+}
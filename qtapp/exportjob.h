@@ -0,0 +1,39 @@
+#ifndef EXPORTJOB_H
+#define EXPORTJOB_H
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <functional>
+
+#include "exporter.h"
+
+// Runs an export in the background. The job gets a progress function that
+// forwards to the progress() signal and returns false once cancel() is called.
+class ExportJob : public QThread {
+  Q_OBJECT
+
+ public:
+  using Job = std::function<bool(const ExportProgress &progress)>;
+
+  ExportJob(const QString &name, Job job, QObject *parent = nullptr);
+  ~ExportJob();
+  const QString &name() const { return name_; }
+  bool isCancelled() const { return cancelled_; }
+
+ public slots:
+  void cancel();
+
+ signals:
+  void progress(int done, int total);
+  void done(bool ok);
+
+ protected:
+  void run() override;
+
+ private:
+  QString name_;
+  Job job_;
+  std::atomic<bool> cancelled_{false};
+};
+
+#endif  // EXPORTJOB_H
@@ -0,0 +1,68 @@
+#include "exportjournal.h"
+
+#include <cstdio>
+#include <sstream>
+
+std::string journalKey(const std::string &description) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : description) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx",
+                static_cast<unsigned long long>(h));
+  return buf;
+}
+
+ExportJournal::ExportJournal(const std::string &path, const std::string &key,
+                             const std::string &data)
+    : path_(path), key_(key), data_(data) {
+  std::ifstream ifile(path_);
+  std::string line;
+  std::string stored;
+  if (std::getline(ifile, line) && line == key &&
+      std::getline(ifile, stored) && !ifile.eof()) {
+    // The last complete line wins, a crash may have left a partial one.
+    while (std::getline(ifile, line)) {
+      if (ifile.eof()) break;
+      std::istringstream in(line);
+      size_t n = 0;
+      in >> n;
+      std::vector<Checkpoint> files(n);
+      for (auto &cp : files) in >> cp.rows >> cp.bytes >> cp.state;
+      if (in && n > 0) resume_ = std::move(files);
+    }
+  }
+  ifile.close();
+  if (!resume_.empty()) data_ = stored;
+
+  // Rewriting the journal also drops a partial last line, if any.
+  const std::vector<Checkpoint> resume = resume_;
+  restart(data_);
+  resume_ = resume;
+  if (!resume_.empty()) commit(resume_);
+}
+
+void ExportJournal::restart(const std::string &data) {
+  data_ = data;
+  resume_.clear();
+  ofile_.close();
+  ofile_.open(path_, std::ios::trunc);
+  ofile_ << key_ << "\n" << data_ << "\n";
+  ofile_.flush();
+}
+
+void ExportJournal::commit(const std::vector<Checkpoint> &files) {
+  ofile_ << files.size();
+  for (const auto &cp : files) {
+    ofile_ << " " << cp.rows << " " << cp.bytes << " " << cp.state;
+  }
+  ofile_ << "\n";
+  ofile_.flush();
+}
+
+void ExportJournal::finish() {
+  ofile_.close();
+  std::remove(path_.c_str());
+}
@@ -0,0 +1,49 @@
+#ifndef EXPORTJOURNAL_H
+#define EXPORTJOURNAL_H
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "imagewriter.h"
+
+// Progress journal of a streamed export, kept next to its output file. After
+// every strip the state of the output files is appended, so a later run of
+// the same job (same key) can continue from the last strip instead of
+// starting again. The journal is removed once the export is complete.
+//
+// Besides the key it keeps a line of data, what the job depends on but which
+// a later run may not know the same, e.g. a color range taken from the view:
+// a run that resumes continues with the data of the run that started.
+class ExportJournal {
+ public:
+  using Checkpoint = StripImageWriter::Checkpoint;
+
+  // `data` is one line, used unless there is something to resume.
+  ExportJournal(const std::string &path, const std::string &key,
+                const std::string &data = {});
+
+  // Checkpoints of the output files left by a previous run of the job, empty
+  // if there is nothing to resume.
+  const std::vector<Checkpoint> &resumeState() const { return resume_; }
+  // The data of the run that started the export.
+  const std::string &data() const { return data_; }
+
+  // Starts the job over with `data`, when its files can not be resumed.
+  void restart(const std::string &data);
+
+  // Records a finished strip. The files must already be flushed.
+  void commit(const std::vector<Checkpoint> &files);
+  void finish();
+
+ private:
+  std::string path_;
+  std::ofstream ofile_;
+  std::string key_;
+  std::string data_;
+  std::vector<Checkpoint> resume_;
+};
+
+// Stable (FNV-1a) hash of a job description, used as journal key.
+std::string journalKey(const std::string &description);
+
+#endif  // EXPORTJOURNAL_H
@@ -1,8 +1,8 @@
-#include <QDebug>
 #include <functional>
 #include <limits>
 
 #include "fractals.h"
+#include "kernels.h"
 
 void Family00::Init(const FractalParameters &p) {
   Fractal::Init(p);
@@ -137,3 +137,20 @@ double Family00::CalcEscapeMandelbrot(const cmplx &c) const {
   }
   return iter;
 }
+
+void Family00::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const {
+  if (orbit_trap != 0) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  EscapeParams p;
+  p.mandelbrot = mandelbrot;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.q = q_;
+  p.th_norm = th_norm_;
+  p.max_iter = max_iter_;
+  kernels(familyIsa(0)).escape00(p, x0, dx, k0, n, y, out);
+}
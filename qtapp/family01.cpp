@@ -1,8 +1,8 @@
-#include <QDebug>
 #include <functional>
 #include <limits>
 
 #include "fractals.h"
+#include "kernels.h"
 
 void Family01::Init(const FractalParameters &p) {
   Fractal::Init(p);
@@ -99,3 +99,22 @@ double Family01::CalcEscapeMandelbrot(const cmplx &c) const {
   // qDebug() << "BB" <<  iter ;
   return iter;
 }
+
+void Family01::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const {
+  if (orbit_trap != 0) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  EscapeParams p;
+  p.mandelbrot = mandelbrot;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.z0_re = c_.real();
+  p.z0_im = c_.imag();
+  p.it0 = 1;
+  p.th_norm = th_norm_;
+  p.max_iter = max_iter_;
+  kernels(familyIsa(1)).escape01(p, x0, dx, k0, n, y, out);
+}
@@ -2,6 +2,7 @@
 #include <limits>
 
 #include "fractals.h"
+#include "kernels.h"
 
 void Family02::FastPow2Inline(dbltype &x, dbltype &y) {
   dbltype x2 = x * x;
@@ -139,3 +140,23 @@ double Family02::CalcEscapeMandelbrot(const cmplx &c) const {
   }
   return iter;
 }
+
+void Family02::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const {
+  if (orbit_trap != 0 || n_ < 3 || n_ > 6) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  EscapeParams p;
+  p.mandelbrot = mandelbrot;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.z0_re = c_.real();
+  p.z0_im = c_.imag();
+  p.it0 = 1;
+  p.n = n_;
+  p.th_norm = th_norm_;
+  p.max_iter = max_iter_;
+  kernels(familyIsa(2)).escape02(p, x0, dx, k0, n, y, out);
+}
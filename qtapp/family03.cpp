@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <functional>
 #include <limits>
 
 #include "fractals.h"
+#include "kernels.h"
 
 dbltype reps = 1e-7;
 
@@ -11,6 +13,11 @@ void Family03::Init(const FractalParameters &p) {
   c_.imag(p.c.imag());
   n_ = p.n;
   alpha_ = static_cast<dbltype>(n_ - 1) / n_;
+  if (plan_) {
+    roots_.Init(n_, 0.0, c_, reps);
+  } else {
+    roots_ = NewtonRoots();
+  }
   switch (n_ - 1) {
     case 1:
       funct_ = std::bind(Family02::FastPow1Inline, std::placeholders::_1,
@@ -93,6 +100,10 @@ double Family03::CalcEscapeJulia(const cmplx &z) const {
     y = y2;
     rdem = std::max(std::abs(x1 - x), std::abs(y1 - y));
     if (rdem < reps) break;
+    if (rdem < roots_.gate()) {
+      const int steps = roots_.RemainingSteps(x, y);
+      if (steps > 0) return std::min(iter + steps, max_iter_);
+    }
   }
   return iter;
 }
@@ -100,3 +111,23 @@ double Family03::CalcEscapeJulia(const cmplx &z) const {
 double Family03::CalcEscapeMandelbrot(const cmplx &c) const {
   return CalcEscapeJulia(c);
 }
+
+void Family03::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const {
+  if (orbit_trap != 0 || n_ < 2 || n_ > 7) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  // The Mandelbrot sets are the Julia ones.
+  EscapeParams p;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.n = n_;
+  p.max_iter = max_iter_;
+  p.alpha = alpha_;
+  p.eps = reps;
+  p.roots = &roots_;
+  p.gate = roots_.gate();
+  kernels(familyIsa(3)).escape03(p, x0, dx, k0, n, y, out);
+}
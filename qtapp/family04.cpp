@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <functional>
 #include <limits>
 
 #include "fractals.h"
+#include "kernels.h"
 
 void Family04::Init(const FractalParameters &p) {
   Fractal::Init(p);
@@ -11,6 +13,11 @@ void Family04::Init(const FractalParameters &p) {
   q_.imag(p.q.imag());
   n_ = p.n;
   alpha_ = static_cast<dbltype>(n_ - 1) / n_;
+  if (plan_) {
+    roots_.Init(n_, q_, c_, Fractal::kEps);
+  } else {
+    roots_ = NewtonRoots();
+  }
   switch (n_ - 1) {
     case 1:
       funct_ = std::bind(Family02::FastPow1Inline, std::placeholders::_1,
@@ -127,6 +134,10 @@ double Family04::CalcEscapeJulia(const cmplx &z) const {
     x = tmp;
     rdem = std::max(std::abs(x1 - x), std::abs(y1 - y));
     if (rdem < Fractal::kEps) break;
+    if (rdem < roots_.gate()) {
+      const int steps = roots_.RemainingSteps(x, y);
+      if (steps > 0) return std::min(iter + steps, max_iter_);
+    }
   }
   return iter;
 }
@@ -159,3 +170,28 @@ double Family04::CalcEscapeMandelbrot(const cmplx &c) const {
   }
   return iter;
 }
+
+void Family04::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const {
+  if (orbit_trap != 0 || n_ < 2 || n_ > 7) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  EscapeParams p;
+  p.mandelbrot = mandelbrot;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.q = q_.real();
+  p.q_im = q_.imag();
+  p.n = n_;
+  p.max_iter = max_iter_;
+  p.alpha = alpha_;
+  p.eps = Fractal::kEps;
+  // The roots of the Mandelbrot sets change per pixel.
+  if (!mandelbrot) {
+    p.roots = &roots_;
+    p.gate = roots_.gate();
+  }
+  kernels(familyIsa(4)).escape04(p, x0, dx, k0, n, y, out);
+}
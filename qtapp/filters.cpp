@@ -0,0 +1,101 @@
+#include "filters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "kernels.h"
+#include "renderscheduler.h"
+
+namespace {
+
+// A tile of kTileRows x kTileCols outputs plus its 2 * radius halo rows stays
+// around 256KB, so the horizontal result is still in L2 for the vertical pass.
+constexpr int kTileRows = 64;
+constexpr int kTileCols = 512;
+
+// Horizontal pass of row `in` for the columns [c0, c1) into out[0, c1 - c0).
+void horizontalPass(const double *in, const int C, const int c0, const int c1,
+                    const double *k, const int radius, double *out) {
+  const int taps = 2 * radius + 1;
+  const int begin = std::clamp(radius, c0, c1);
+  const int end = std::clamp(C - radius, begin, c1);
+
+  auto clampedTap = [&](int c) {
+    double sum = 0.0;
+    for (int t = 0; t < taps; ++t) {
+      sum += k[t] * in[std::clamp(c - radius + t, 0, C - 1)];
+    }
+    return sum;
+  };
+
+  for (int c = c0; c < begin; ++c) out[c - c0] = clampedTap(c);
+
+  // Interior: taps are outer so the column loop is a plain axpy.
+  const int n = end - begin;
+  if (n > 0) {
+    const Kernels &kern = kernels();
+    double *o = out + (begin - c0);
+    const double *src = in + (begin - radius);
+    kern.scale(o, src, k[0], n);
+    for (int t = 1; t < taps; ++t) kern.addScaled(o, src + t, k[t], n);
+  }
+
+  for (int c = end; c < c1; ++c) out[c - c0] = clampedTap(c);
+}
+
+}  // namespace
+
+std::vector<double> gaussianKernel1D(int radius) {
+  radius = std::max(radius, 1);
+  const double sigma = radius / 2.0;
+  std::vector<double> k(2 * radius + 1);
+  for (int i = -radius; i <= radius; ++i) {
+    k[i + radius] = std::exp(-0.5 * i * i / (sigma * sigma));
+  }
+  const double sum = std::accumulate(k.begin(), k.end(), 0.0);
+  for (auto &v : k) v /= sum;
+  return k;
+}
+
+void applyLowPassFilter(std::vector<double> &input, int R, int C, int radius) {
+  if (R <= 0 || C <= 0 || radius <= 0) return;
+  const std::vector<double> kernel = gaussianKernel1D(radius);
+  const double *k = kernel.data();
+  const int taps = 2 * radius + 1;
+
+  const int tilesY = (R + kTileRows - 1) / kTileRows;
+  const int tilesX = (C + kTileCols - 1) / kTileCols;
+
+  std::vector<double> output(input.size());
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, tilesY * tilesX, [&](int tile) {
+        const int r0 = (tile / tilesX) * kTileRows;
+        const int r1 = std::min(r0 + kTileRows, R);
+        const int c0 = (tile % tilesX) * kTileCols;
+        const int c1 = std::min(c0 + kTileCols, C);
+        const int w = c1 - c0;
+        const int rows = r1 - r0 + 2 * radius;
+
+        // Row j of tmp is the horizontal pass of the image row
+        // clamp(r0 - radius + j), this takes care of the top/bottom borders.
+        thread_local std::vector<double> tmp;
+        tmp.resize(static_cast<size_t>(rows) * w);
+        for (int j = 0; j < rows; ++j) {
+          const int r = std::clamp(r0 - radius + j, 0, R - 1);
+          horizontalPass(&input[static_cast<size_t>(r) * C], C, c0, c1, k,
+                         radius, &tmp[static_cast<size_t>(j) * w]);
+        }
+
+        const Kernels &kern = kernels();
+        for (int r = r0; r < r1; ++r) {
+          double *o = &output[static_cast<size_t>(r) * C + c0];
+          const double *src = &tmp[static_cast<size_t>(r - r0) * w];
+          kern.scale(o, src, k[0], w);
+          for (int t = 1; t < taps; ++t) {
+            kern.addScaled(o, src + static_cast<size_t>(t) * w, k[t], w);
+          }
+        }
+      });
+  input.swap(output);
+}
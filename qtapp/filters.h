@@ -0,0 +1,14 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+#include <vector>
+
+// 1D gaussian taps (2 * radius + 1 values, sigma = radius / 2) normalized to 1.
+std::vector<double> gaussianKernel1D(int radius);
+
+// Separable gaussian low pass filter over a R x C row-major buffer. Borders
+// are clamped. The image is processed in cache sized tiles on the export
+// priority of the RenderScheduler.
+void applyLowPassFilter(std::vector<double> &input, int R, int C,
+                        int radius = 2);
+
+#endif  // FILTERS_H
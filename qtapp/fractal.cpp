@@ -1,11 +1,36 @@
-#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 
 #include "fractals.h"
 
 dbltype Fractal::kEps = 1e-7;
 
-std::unique_ptr<Fractal> Fractal::Create(const FractalParameters *params) {
+namespace {
+
+// Family00 with Re(Q) = 0 iterates z^2 + C as long as its Q terms are 0, i.e.
+// |z^2|^2 can't overflow before the escape test: inf * 0 would be a NaN.
+bool isQuadratic(const FractalParameters &p) {
+  switch (p.fractal_family) {
+    case 0:
+      return p.q.real() == 0 && std::abs(p.max_norm) < 1e75;
+    case 2:
+      return p.n == 2;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Fractal> Fractal::Create(const FractalParameters *params,
+                                         bool plan) {
   std::unique_ptr<Fractal> result;
+  if (plan && isQuadratic(*params)) {
+    result.reset(new Quadratic);
+    result->Init(*params);
+    return result;
+  }
   switch (params->fractal_family) {
     case 0:
       result.reset(new Family00);
@@ -23,11 +48,11 @@ std::unique_ptr<Fractal> Fractal::Create(const FractalParameters *params) {
       result.reset(new Family04);
       break;
     default:
-      qErrnoWarning(
-          "Wrong fractal family number. Expected [0,1,2,3,4], but get %d",
-          params->fractal_family);
-      break;
+      std::cerr << "Wrong fractal family number. Expected [0,1,2,3,4], but get "
+                << params->fractal_family << std::endl;
+      return result;
   }
+  result->plan_ = plan;
   result->Init(*params);
   return result;
 }
@@ -47,12 +72,35 @@ std::function<double(const cmplx &z)> Fractal::GetCouloringFunction(
                                     std::placeholders::_1);
       break;
     default:
-      qDebug() << "Error: Returing empty Couloring function.";
-      qDebug() << "orbit_trap: " << orbit_trap << "mandelbrot: " << mandelbrot;
+      std::cerr << "Error: Returing empty Couloring function. orbit_trap: "
+                << orbit_trap << " mandelbrot: " << mandelbrot << std::endl;
       return {};
   }
 };
 
+void Fractal::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                           dbltype dx, int k0, int n, dbltype y,
+                           double *out) const {
+  using Calc = double (Fractal::*)(const cmplx &) const;
+  Calc calc = nullptr;
+  switch (orbit_trap) {
+    case 0:
+      calc = mandelbrot ? &Fractal::CalcEscapeMandelbrot
+                        : &Fractal::CalcEscapeJulia;
+      break;
+    case 1:
+      calc = mandelbrot ? &Fractal::CalcFinalNormMandelbrot
+                        : &Fractal::CalcFinalNormJulia;
+      break;
+    default:
+      std::fill(out, out + n, 0.0);
+      return;
+  }
+  for (int j = 0; j < n; ++j) {
+    out[j] = (this->*calc)({x0 + (k0 + j) * dx, y});
+  }
+}
+
 void Fractal::Init(const FractalParameters &p) {
   orbit_pt_.real(p.orbit_pt.real());
   orbit_pt_.imag(p.orbit_pt.imag());
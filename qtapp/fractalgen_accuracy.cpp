@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "accuracy.h"
+#include "cpufeatures.h"
+#include "renderjob.h"
+#include "renderscheduler.h"
+
+namespace {
+
+const char kUsage[] =
+    "usage: fractalgen-accuracy [options]\n"
+    "\n"
+    "Compares the render paths to the scalar reference over a corpus of\n"
+    "viewports of every family and writes the errors as JSON. Exits with 1\n"
+    "when a case is over the error budget.\n"
+    "\n"
+    "options:\n"
+    "  -o, --output FILE          JSON file, stdout by default\n"
+    "  --path NAME                only this render path, see below\n"
+    "  --size N                   images are N x N pixels (128)\n"
+    "  --max-iterations N         iteration limit (200)\n"
+    "  --max-mismatch RATE        allowed share of differing pixels (0)\n"
+    "  --max-iteration-diff N     allowed escape time difference (0)\n"
+    "  --max-relative-error E     allowed final norm relative error (0)\n"
+    "  --isa NAME                 sse2, avx2 or avx512 kernels, the best one\n"
+    "                             of the CPU by default\n"
+    "  -h, --help                 show this help\n"
+    "\n"
+    "paths:\n"
+    "  span      Fractal::EvaluateSpan on the render pool, the exports and\n"
+    "            the interactive frames\n"
+    "  tiles     EvaluateSpan in spans of 32 pixels, the interactive frames\n"
+    "            with the render statistics on\n"
+    "  function  GetCouloringFunction per pixel\n";
+
+struct Options {
+  std::string path;
+  int size = 128;
+  int maxIterations = 200;
+  double maxMismatch = 0.0;
+  double maxIterationDiff = 0.0;
+  double maxRelativeError = 0.0;
+};
+
+// An implementation of the image that should match the reference.
+struct RenderPath {
+  const char *name;
+  std::function<std::vector<double>(const FractalParameters &,
+                                    const ExportSettings &)>
+      render;
+};
+
+std::vector<double> renderSpan(const FractalParameters &params,
+                               const ExportSettings &s) {
+  const auto fractal = Fractal::Create(&params);
+  const dbltype dx = (s.x1 - s.x0) / (s.W - 1);
+  const dbltype dy = (s.y1 - s.y0) / (s.H - 1);
+  std::vector<double> data(static_cast<size_t>(s.W) * s.H);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, s.H, [&](int i) {
+        fractal->EvaluateSpan(params.mandelbrot, params.orbit_trap, s.x0, dx,
+                              0, s.W, s.y0 + i * dy, data.data() + i * s.W);
+      });
+  return data;
+}
+
+// The tiles of the render statistics: short spans that start inside the row,
+// where the Newton kernels soon run out of pixels to refill their lanes with.
+std::vector<double> renderTiles(const FractalParameters &params,
+                                const ExportSettings &s) {
+  constexpr int kTile = 32;
+  const auto fractal = Fractal::Create(&params);
+  const dbltype dx = (s.x1 - s.x0) / (s.W - 1);
+  const dbltype dy = (s.y1 - s.y0) / (s.H - 1);
+  std::vector<double> data(static_cast<size_t>(s.W) * s.H);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Interactive, 0, s.H, [&](int i) {
+        for (int j0 = 0; j0 < s.W; j0 += kTile) {
+          fractal->EvaluateSpan(params.mandelbrot, params.orbit_trap, s.x0, dx,
+                                j0, std::min(kTile, s.W - j0), s.y0 + i * dy,
+                                data.data() + i * s.W + j0);
+        }
+      });
+  return data;
+}
+
+std::vector<double> renderFunction(const FractalParameters &params,
+                                   const ExportSettings &s) {
+  const auto fractal = Fractal::Create(&params);
+  const auto f =
+      fractal->GetCouloringFunction(params.mandelbrot, params.orbit_trap);
+  const dbltype dx = (s.x1 - s.x0) / (s.W - 1);
+  const dbltype dy = (s.y1 - s.y0) / (s.H - 1);
+  std::vector<double> data(static_cast<size_t>(s.W) * s.H);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, s.H, [&](int i) {
+        for (int j = 0; j < s.W; ++j) {
+          data[static_cast<size_t>(i) * s.W + j] =
+              f({s.x0 + j * dx, s.y0 + i * dy});
+        }
+      });
+  return data;
+}
+
+const RenderPath kPaths[] = {
+    {"span", renderSpan},
+    {"tiles", renderTiles},
+    {"function", renderFunction},
+};
+
+struct Viewport {
+  const char *name;
+  double x0, x1, y0, y1;
+};
+
+// The whole set, a boundary zoom, the interior of the main cardioid of
+// z^2 + c and a zoom deep enough for the spacing to be near the double
+// precision of the coordinates.
+const Viewport kViewports[] = {
+    {"full", -2.0, 2.0, -2.0, 2.0},
+    {"edge", -0.76, -0.73, 0.10, 0.13},
+    {"interior", -0.3, -0.1, -0.1, 0.1},
+    {"deep", -0.743643887 - 1e-11, -0.743643887 + 1e-11, 0.131825904 - 1e-11,
+     0.131825904 + 1e-11},
+};
+
+constexpr int kFamilies = 5;
+constexpr int kOrbitModes = 15;
+
+struct Case {
+  int family;
+  bool mandelbrot;
+  bool finalNorm;
+  int orbitMode;
+  int n;
+  std::complex<double> q;
+  const Viewport *viewport;
+};
+
+// Q of the cases with one, Re(Q) and Im(Q) both not 0.
+const std::complex<double> kQ(0.3, -0.2);
+
+// Every family with the escape time on every viewport, and every orbit
+// metric on the whole set. The families with a free power also run with 5,
+// which has its own power code, and 8, which takes the generic one. Family00
+// and Family04 also run with a Q that is not 0: with Q = 0 the first one is
+// planned as z^2 + C and the second one has the roots of z^n + C in closed
+// form.
+std::vector<Case> corpus() {
+  std::vector<Case> cases;
+  for (int family = 0; family < kFamilies; ++family) {
+    for (const int n : {2, 5, 8}) {
+      if (family < 2 && n != 2) continue;
+      for (const std::complex<double> q : {std::complex<double>(), kQ}) {
+        if (q != 0.0 && family != 0 && family != 4) continue;
+        for (const bool mandelbrot : {false, true}) {
+          for (const Viewport &v : kViewports) {
+            cases.push_back({family, mandelbrot, false, 0, n, q, &v});
+          }
+          for (int mode = 0; mode < kOrbitModes; ++mode) {
+            cases.push_back(
+                {family, mandelbrot, true, mode, n, q, &kViewports[0]});
+          }
+        }
+      }
+    }
+  }
+  return cases;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options o;
+  std::string output;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "-h" || arg == "--help") {
+      std::fputs(kUsage, stdout);
+      return 0;
+    } else if ((arg == "-o" || arg == "--output") && hasValue) {
+      output = argv[++i];
+    } else if (arg == "--path" && hasValue) {
+      o.path = argv[++i];
+    } else if (arg == "--size" && hasValue) {
+      o.size = std::max(std::atoi(argv[++i]), 2);
+    } else if (arg == "--max-iterations" && hasValue) {
+      o.maxIterations = std::max(std::atoi(argv[++i]), 2);
+    } else if (arg == "--isa" && hasValue) {
+      Isa isa;
+      if (!parseIsa(argv[++i], &isa) || !setIsa(isa)) {
+        std::fprintf(stderr, "can not use the instruction set '%s'\n",
+                     argv[i]);
+        return 2;
+      }
+    } else if (arg == "--max-mismatch" && hasValue) {
+      o.maxMismatch = std::atof(argv[++i]);
+    } else if (arg == "--max-iteration-diff" && hasValue) {
+      o.maxIterationDiff = std::atof(argv[++i]);
+    } else if (arg == "--max-relative-error" && hasValue) {
+      o.maxRelativeError = std::atof(argv[++i]);
+    } else {
+      std::fputs(kUsage, stderr);
+      return 2;
+    }
+  }
+  std::vector<const RenderPath *> paths;
+  for (const RenderPath &path : kPaths) {
+    if (o.path.empty() || o.path == path.name) paths.push_back(&path);
+  }
+  if (paths.empty()) {
+    std::fprintf(stderr, "unknown path '%s'\n", o.path.c_str());
+    return 2;
+  }
+
+  FILE *out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+  if (!out) {
+    std::fprintf(stderr, "can not create %s\n", output.c_str());
+    return 1;
+  }
+  std::fprintf(out,
+               "{\n  \"config\": {\"size\": %d, \"max_iterations\": %d, "
+               "\"isa\": \"%s\", \"max_mismatch\": %g, "
+               "\"max_iteration_diff\": %g, \"max_relative_error\": %g},\n"
+               "  \"cases\": [",
+               o.size, o.maxIterations, isaName(activeIsa()), o.maxMismatch,
+               o.maxIterationDiff, o.maxRelativeError);
+
+  const std::vector<Case> cases = corpus();
+  int failures = 0;
+  bool first = true;
+  for (size_t k = 0; k < cases.size(); ++k) {
+    const Case &c = cases[k];
+    std::fprintf(stderr, "\r%zu/%zu", k + 1, cases.size());
+    FractalParameters p = RenderJob().params;
+    p.fractal_family = c.family;
+    p.mandelbrot = c.mandelbrot;
+    p.orbit_trap = c.finalNorm;
+    p.orbit_mode = c.orbitMode;
+    p.n = c.n;
+    p.q = c.q;
+    p.max_iterations = o.maxIterations;
+    const Viewport &v = *c.viewport;
+    ExportSettings s{};
+    s.W = o.size;
+    s.H = o.size;
+    s.x0 = v.x0;
+    s.x1 = v.x1;
+    s.y0 = v.y0;
+    s.y1 = v.y1;
+    const std::vector<double> reference = renderReference(p, s);
+
+    for (const RenderPath *path : paths) {
+      const AccuracyReport r = compareImages(path->render(p, s), reference);
+      // The escape time error is an iteration count, the final norm one a
+      // relative trap distance error; a NaN or infinity appearing or
+      // disappearing is always over the budget.
+      const bool over =
+          r.mismatchRate() > o.maxMismatch || r.nonfinite > 0 ||
+          (c.finalNorm ? r.max_rel_error > o.maxRelativeError
+                       : r.max_abs_diff > o.maxIterationDiff);
+      if (over) {
+        ++failures;
+        std::fprintf(stderr,
+                     "\n%s: family %d %s %s orbit mode %d n %d q %g %g %s: "
+                     "%.4g%% of the pixels differ",
+                     path->name, c.family,
+                     c.mandelbrot ? "mandelbrot" : "julia",
+                     c.finalNorm ? "final norm" : "escape", c.orbitMode, c.n,
+                     c.q.real(), c.q.imag(), v.name,
+                     100.0 * r.mismatchRate());
+      }
+      const std::string orbitMode =
+          c.finalNorm ? std::to_string(c.orbitMode) : "null";
+      char error[96];
+      if (c.finalNorm) {
+        std::snprintf(error, sizeof(error),
+                      "\"max_relative_error\": %.6g, "
+                      "\"mean_relative_error\": %.6g",
+                      r.max_rel_error, r.mean_rel_error);
+      } else {
+        std::snprintf(error, sizeof(error), "\"max_iteration_diff\": %.6g",
+                      r.max_abs_diff);
+      }
+      std::fprintf(out,
+                   "%s\n    {\"path\": \"%s\", \"family\": %d, \"set\": "
+                   "\"%s\", \"coloring\": \"%s\", \"orbit_mode\": %s, \"n\": "
+                   "%d, \"q\": [%g, %g], \"viewport\": \"%s\", "
+                   "\"pixels\": %zu, \"mismatch_rate\": %.6g, "
+                   "\"nonfinite\": %zu, %s, \"within_budget\": %s}",
+                   first ? "" : ",", path->name, c.family,
+                   c.mandelbrot ? "mandelbrot" : "julia",
+                   c.finalNorm ? "final_norm" : "escape", orbitMode.c_str(),
+                   c.n, c.q.real(), c.q.imag(), v.name, r.pixels,
+                   r.mismatchRate(), r.nonfinite, error,
+                   over ? "false" : "true");
+      first = false;
+    }
+  }
+  std::fputc('\n', stderr);
+  std::fprintf(out, "\n  ],\n  \"failures\": %d\n}\n", failures);
+  if (out != stdout) std::fclose(out);
+  return failures ? 1 : 0;
+}
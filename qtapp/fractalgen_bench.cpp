@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "colorlut.h"
+#include "cpufeatures.h"
+#include "filters.h"
+#include "fractals.h"
+#include "perfcounters.h"
+#include "renderjob.h"
+#include "renderscheduler.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kUsage[] =
+    "usage: fractalgen-bench [options]\n"
+    "\n"
+    "Measures the fractal kernels, the color mapping and the smoothing filter\n"
+    "and writes the results as JSON.\n"
+    "\n"
+    "options:\n"
+    "  -o, --output FILE       JSON file, stdout by default\n"
+    "  --threads N             render workers (1)\n"
+    "  --size N                kernel viewports are N x N pixels (256)\n"
+    "  --repeat N              runs per case, the fastest is kept (3)\n"
+    "  --max-iterations N      iteration limit of the kernels (200)\n"
+    "  --only GROUP            kernels, n, colorize or smoothing\n"
+    "  --isa NAME              sse2, avx2 or avx512 kernels, the best one of\n"
+    "                          the CPU by default\n"
+    "  --no-counters           no hardware counters on the kernels\n"
+    "  -h, --help              show this help\n";
+
+struct Options {
+  int threads = 1;
+  int size = 256;
+  int repeat = 3;
+  int maxIterations = 200;
+  std::string only;
+  bool counters = true;
+};
+
+struct Viewport {
+  const char *name;
+  double x0, x1, y0, y1;
+};
+
+// The whole set, a zoom on its boundary and an area mostly inside the main
+// cardioid of z^2 + c, where Mandelbrot pixels hit the iteration limit.
+const Viewport kViewports[] = {
+    {"full", -2.0, 2.0, -2.0, 2.0},
+    {"edge", -0.76, -0.73, 0.10, 0.13},
+    {"interior", -0.3, -0.1, -0.1, 0.1},
+};
+
+constexpr int kFamilies = 5;
+constexpr int kOrbitModes = 15;
+const int kPowers[] = {2, 3, 4, 5, 6, 8};
+
+struct KernelCase {
+  int family;
+  bool mandelbrot;
+  bool finalNorm;  // orbit trap coloring instead of the escape time
+  int orbitMode;   // only used by the final norm
+  int n;
+  const Viewport *viewport;
+};
+
+// Hardware counts per pixel of one more run of a kernel, null when the
+// counter is not available.
+std::string counterJson(PerfCounters *counters,
+                        const std::function<void()> &run, double pixels) {
+  const char *const names[PerfCounters::kCounters] = {
+      "cycles", "instructions", "branch_misses", "cache_misses"};
+  PerfCounters::Values v;
+  v.fill(-1.0);
+  if (counters) {
+    counters->start();
+    run();
+    counters->stop();
+    v = counters->read();
+  }
+  std::string json;
+  char buf[64];
+  for (int c = 0; c < PerfCounters::kCounters; ++c) {
+    if (v[c] < 0.0) {
+      std::snprintf(buf, sizeof(buf), ", \"%s_per_pixel\": null", names[c]);
+    } else {
+      std::snprintf(buf, sizeof(buf), ", \"%s_per_pixel\": %.6g", names[c],
+                    v[c] / pixels);
+    }
+    json += buf;
+  }
+  const double cycles = v[PerfCounters::kCycles];
+  const double instructions = v[PerfCounters::kInstructions];
+  if (cycles > 0.0 && instructions >= 0.0) {
+    std::snprintf(buf, sizeof(buf), ", \"ipc\": %.4g", instructions / cycles);
+  } else {
+    std::snprintf(buf, sizeof(buf), ", \"ipc\": null");
+  }
+  return json + buf;
+}
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Best of `repeat` runs of `run`, which returns its own time.
+double best(int repeat, const std::function<double()> &run) {
+  double seconds = std::numeric_limits<double>::max();
+  for (int r = 0; r < repeat; ++r) seconds = std::min(seconds, run());
+  return seconds;
+}
+
+void printKernel(FILE *out, const KernelCase &c, const Options &o,
+                 PerfCounters *counters, bool first) {
+  FractalParameters p = RenderJob().params;
+  p.fractal_family = c.family;
+  p.mandelbrot = c.mandelbrot;
+  p.orbit_trap = c.finalNorm;
+  p.orbit_mode = c.orbitMode;
+  p.n = c.n;
+  p.max_iterations = o.maxIterations;
+  const auto fractal = Fractal::Create(&p);
+
+  const int N = o.size;
+  const Viewport &v = *c.viewport;
+  const double dx = (v.x1 - v.x0) / (N - 1);
+  const double dy = (v.y1 - v.y0) / (N - 1);
+  std::vector<double> data(static_cast<size_t>(N) * N);
+  auto render = [&](bool finalNorm) {
+    RenderScheduler::instance().parallelFor(
+        RenderPriority::Export, 0, N, [&](int i) {
+          fractal->EvaluateSpan(c.mandelbrot, finalNorm, v.x0, dx, 0, N,
+                                v.y0 + i * dy, data.data() + i * N);
+        });
+  };
+  const double seconds = best(o.repeat, [&] {
+    const Clock::time_point start = Clock::now();
+    render(c.finalNorm);
+    return secondsSince(start);
+  });
+  const double pixels = static_cast<double>(N) * N;
+  const std::string hardware =
+      counterJson(counters, [&] { render(c.finalNorm); }, pixels);
+  // Both colorings break on the same conditions, the escape time is the
+  // iteration count of either.
+  render(false);
+  const double iterations = std::accumulate(data.begin(), data.end(), 0.0);
+  const std::string orbitMode =
+      c.finalNorm ? std::to_string(c.orbitMode) : "null";
+
+  std::fprintf(out,
+               "%s\n    {\"family\": %d, \"set\": \"%s\", \"coloring\": "
+               "\"%s\", \"orbit_mode\": %s, \"n\": %d, \"viewport\": \"%s\", "
+               "\"seconds\": %.6g, \"pixels_per_second\": %.6g, "
+               "\"iterations_per_second\": %.6g, \"iterations_per_pixel\": "
+               "%.6g%s}",
+               first ? "" : ",", c.family,
+               c.mandelbrot ? "mandelbrot" : "julia",
+               c.finalNorm ? "final_norm" : "escape",
+               orbitMode.c_str(), c.n, v.name, seconds,
+               pixels / seconds, iterations / seconds, iterations / pixels,
+               hardware.c_str());
+}
+
+void printKernels(FILE *out, const std::vector<KernelCase> &cases,
+                  const char *name, const Options &o,
+                  PerfCounters *counters) {
+  std::fprintf(out, ",\n  \"%s\": [", name);
+  for (size_t i = 0; i < cases.size(); ++i) {
+    std::fprintf(stderr, "\r%s %zu/%zu", name, i + 1, cases.size());
+    printKernel(out, cases[i], o, counters, i == 0);
+  }
+  std::fprintf(out, "\n  ]");
+  std::fputc('\n', stderr);
+}
+
+void printColorize(FILE *out, const Options &o) {
+  constexpr int kValues = 1 << 22;
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> dist(1.0, o.maxIterations);
+  std::vector<double> data(kValues);
+  for (auto &d : data) d = dist(rng);
+  std::vector<uint32_t> image(kValues);
+
+  std::fprintf(out, ",\n  \"colorize\": [");
+  bool first = true;
+  for (const bool periodic : {false, true}) {
+    for (const bool log : {false, true}) {
+      const ColorLut lut = ColorLut::FromPreset("gpHot", 350, periodic);
+      const double seconds = best(o.repeat, [&] {
+        const Clock::time_point start = Clock::now();
+        lut.colorize(data.data(), 1.0, o.maxIterations, image.data(), kValues,
+                     1, log);
+        return secondsSince(start);
+      });
+      std::fprintf(out,
+                   "%s\n    {\"levels\": %d, \"periodic\": %s, \"log\": %s, "
+                   "\"values\": %d, \"seconds\": %.6g, "
+                   "\"values_per_second\": %.6g}",
+                   first ? "" : ",", lut.levelCount(),
+                   periodic ? "true" : "false", log ? "true" : "false",
+                   kValues, seconds, kValues / seconds);
+      first = false;
+    }
+  }
+  std::fprintf(out, "\n  ]");
+}
+
+void printSmoothing(FILE *out, const Options &o) {
+  constexpr int kRows = 2048;
+  constexpr int kCols = 2048;
+  std::mt19937_64 rng(2);
+  std::uniform_real_distribution<double> dist(0.0, o.maxIterations);
+  std::vector<double> input(static_cast<size_t>(kRows) * kCols);
+  for (auto &d : input) d = dist(rng);
+
+  std::fprintf(out, ",\n  \"smoothing\": [");
+  bool first = true;
+  for (const int radius : {1, 2, 4, 8}) {
+    const double seconds = best(o.repeat, [&] {
+      std::vector<double> data = input;
+      const Clock::time_point start = Clock::now();
+      applyLowPassFilter(data, kRows, kCols, radius);
+      return secondsSince(start);
+    });
+    std::fprintf(out,
+                 "%s\n    {\"radius\": %d, \"rows\": %d, \"cols\": %d, "
+                 "\"seconds\": %.6g, \"pixels_per_second\": %.6g}",
+                 first ? "" : ",", radius, kRows, kCols, seconds,
+                 static_cast<double>(kRows) * kCols / seconds);
+    first = false;
+  }
+  std::fprintf(out, "\n  ]");
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options o;
+  std::string output;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "-h" || arg == "--help") {
+      std::fputs(kUsage, stdout);
+      return 0;
+    } else if ((arg == "-o" || arg == "--output") && hasValue) {
+      output = argv[++i];
+    } else if (arg == "--threads" && hasValue) {
+      o.threads = std::atoi(argv[++i]);
+    } else if (arg == "--size" && hasValue) {
+      o.size = std::max(std::atoi(argv[++i]), 2);
+    } else if (arg == "--repeat" && hasValue) {
+      o.repeat = std::max(std::atoi(argv[++i]), 1);
+    } else if (arg == "--max-iterations" && hasValue) {
+      o.maxIterations = std::max(std::atoi(argv[++i]), 2);
+    } else if (arg == "--no-counters") {
+      o.counters = false;
+    } else if (arg == "--isa" && hasValue) {
+      Isa isa;
+      if (!parseIsa(argv[++i], &isa) || !setIsa(isa)) {
+        std::fprintf(stderr, "can not use the instruction set '%s'\n",
+                     argv[i]);
+        return 2;
+      }
+    } else if (arg == "--only" && hasValue) {
+      o.only = argv[++i];
+    } else {
+      std::fputs(kUsage, stderr);
+      return 2;
+    }
+  }
+
+  SchedulerSettings settings;
+  settings.workers = o.threads;
+  RenderScheduler::instance().configure(settings);
+
+  FILE *out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+  if (!out) {
+    std::fprintf(stderr, "can not create %s\n", output.c_str());
+    return 1;
+  }
+  // After configure(), the counters only follow the threads existing then.
+  std::unique_ptr<PerfCounters> counters;
+  if (o.counters) {
+    counters = std::make_unique<PerfCounters>();
+    if (!counters->available()) {
+      std::fprintf(stderr, "no hardware counters, see perf_event_paranoid\n");
+      counters.reset();
+    }
+  }
+  auto run = [&o](const char *group) {
+    return o.only.empty() || o.only == group;
+  };
+
+  std::fprintf(out,
+               "{\n  \"config\": {\"threads\": %d, \"size\": %d, \"repeat\": "
+               "%d, \"max_iterations\": %d, \"isa\": \"%s\", \"counters\": "
+               "%s, \"compiler\": \"%s\"}",
+               RenderScheduler::instance().workerCount(), o.size, o.repeat,
+               o.maxIterations, isaName(activeIsa()),
+               counters ? "true" : "false",
+#ifdef __VERSION__
+               __VERSION__
+#else
+               "unknown"
+#endif
+  );
+
+  // Every family, set and coloring on the whole set; the orbit metrics only
+  // change the final norm.
+  if (run("kernels")) {
+    std::vector<KernelCase> cases;
+    for (int family = 0; family < kFamilies; ++family) {
+      for (const bool mandelbrot : {false, true}) {
+        cases.push_back({family, mandelbrot, false, 0, 2, &kViewports[0]});
+        for (int mode = 0; mode < kOrbitModes; ++mode) {
+          cases.push_back({family, mandelbrot, true, mode, 2, &kViewports[0]});
+        }
+      }
+    }
+    printKernels(out, cases, "kernels", o, counters.get());
+  }
+
+  // The escape time over the powers and viewports. Family00 and Family01 are
+  // fixed to z^2, so they only appear with n = 2.
+  if (run("n")) {
+    std::vector<KernelCase> cases;
+    for (int family = 0; family < kFamilies; ++family) {
+      for (const int n : kPowers) {
+        if (family < 2 && n != 2) continue;
+        for (const Viewport &v : kViewports) {
+          for (const bool mandelbrot : {false, true}) {
+            cases.push_back({family, mandelbrot, false, 0, n, &v});
+          }
+        }
+      }
+    }
+    printKernels(out, cases, "n", o, counters.get());
+  }
+
+  if (run("colorize")) printColorize(out, o);
+  if (run("smoothing")) printSmoothing(out, o);
+  std::fprintf(out, "\n}\n");
+  if (out != stdout) std::fclose(out);
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "autotune.h"
+#include "cpufeatures.h"
+#include "exporter.h"
+#include "imagewriter.h"
+#include "renderjob.h"
+#include "renderscheduler.h"
+#include "trace.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kUsage[] =
+    "usage: fractalgen-cli [options] PARAMS\n"
+    "       fractalgen-cli --tune\n"
+    "\n"
+    "Renders the image described by the parameter file PARAMS.\n"
+    "\n"
+    "options:\n"
+    "  -o, --output FILE  output file, overrides the one of PARAMS: .raw for\n"
+    "                     the data, .png, .tif/.tiff or .ppm for the colors\n"
+    "  --threads N        render workers, one per allowed CPU by default\n"
+    "  --cpus LIST        CPUs the workers are pinned to, e.g. 0-7,16-23\n"
+    "  --numa             one worker partition per NUMA node\n"
+    "  --isa NAME         kernels built for sse2, avx2 or avx512, the best\n"
+    "                     one of the CPU by default\n"
+    "  --tune             measures the fastest workers, kernels and tiles of\n"
+    "                     this machine again, done on the first run\n"
+    "  --no-tuning        ignores the measured configuration\n"
+    "  --trace FILE       writes a Chrome trace of the render\n"
+    "  -q, --quiet        no progress\n"
+    "  -h, --help         show this help\n";
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string paramFile;
+  std::string output;
+  std::string trace;
+  SchedulerSettings settings;
+  bool quiet = false;
+  bool tune = false;
+  bool tuning = true;
+  bool isaSet = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "-h" || arg == "--help") {
+      std::fputs(kUsage, stdout);
+      return 0;
+    } else if ((arg == "-o" || arg == "--output") && hasValue) {
+      output = argv[++i];
+    } else if (arg == "--threads" && hasValue) {
+      settings.workers = std::atoi(argv[++i]);
+    } else if (arg == "--cpus" && hasValue) {
+      settings.cpus = parseCpuList(argv[++i]);
+    } else if (arg == "--trace" && hasValue) {
+      trace = argv[++i];
+    } else if (arg == "--isa" && hasValue) {
+      Isa isa;
+      if (!parseIsa(argv[++i], &isa) || !setIsa(isa)) {
+        std::fprintf(stderr, "can not use the instruction set '%s'\n",
+                     argv[i]);
+        return 2;
+      }
+      isaSet = true;
+    } else if (arg == "--tune") {
+      tune = true;
+    } else if (arg == "--no-tuning") {
+      tuning = false;
+    } else if (arg == "--numa") {
+      settings.numa = true;
+    } else if (arg == "-q" || arg == "--quiet") {
+      quiet = true;
+    } else if (arg[0] != '-' && paramFile.empty()) {
+      paramFile = arg;
+    } else {
+      std::fputs(kUsage, stderr);
+      return 2;
+    }
+  }
+  if (paramFile.empty() && !tune) {
+    std::fputs(kUsage, stderr);
+    return 2;
+  }
+
+  // The measured configuration, measured now on the first run on a machine.
+  if (tuning || tune) {
+    const std::string tuningFile = defaultTuningFile();
+    TuningProfile profile;
+    std::string error;
+    if (tune || !loadTuning(tuningFile, &profile, &error) ||
+        profile.machine != machineId()) {
+      if (!quiet) {
+        std::fprintf(stderr, "calibrating %s\n", machineId().c_str());
+      }
+      profile = calibrate(settings, [quiet](const std::string &line) {
+        if (!quiet) std::fprintf(stderr, "  %s\n", line.c_str());
+      });
+      if (!saveTuning(tuningFile, profile, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+      } else if (!quiet) {
+        std::fprintf(stderr, "saved to %s\n", tuningFile.c_str());
+      }
+    }
+    if (settings.workers == 0 && settings.cpus.empty()) {
+      settings.workers = profile.workers;
+    }
+    if (!applyTuning(profile, !isaSet)) {
+      std::fprintf(stderr, "%s: this CPU can not run some kernels\n",
+                   tuningFile.c_str());
+    }
+    if (paramFile.empty()) return 0;
+  }
+
+  RenderJob job;
+  std::string error;
+  if (!loadRenderJob(paramFile, &job, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  if (!output.empty()) job.output = output;
+  if (job.output.empty()) {
+    std::fprintf(stderr, "no output file, set one with -o or in %s\n",
+                 paramFile.c_str());
+    return 1;
+  }
+  const bool raw = endsWith(job.output, ".raw");
+  if (!raw && !StripImageWriter::isSupported(job.output)) {
+    std::fprintf(stderr, "unsupported output file '%s'\n", job.output.c_str());
+    return 1;
+  }
+  ColorLut lut;
+  if (!raw) {
+    lut = ColorLut::FromPreset(job.colormap, 350, job.periodic);
+    if (lut.empty()) {
+      std::fprintf(stderr, "unknown colormap '%s'\n", job.colormap.c_str());
+      return 1;
+    }
+  }
+
+  auto &scheduler = RenderScheduler::instance();
+  if (!scheduler.configure(settings)) {
+    std::fprintf(stderr, "some scheduler settings could not be applied\n");
+  }
+
+  auto &tracer = Tracer::instance();
+  if (!trace.empty()) {
+    if (!tracer.start(trace)) {
+      std::fprintf(stderr, "can not create %s\n", trace.c_str());
+      return 1;
+    }
+    tracer.setThreadName("main");
+  }
+
+  const ExportSettings &s = job.settings;
+  const ExportProgress progress = [quiet](int done, int total) {
+    if (!quiet) std::fprintf(stderr, "\r%d/%d rows", done, total);
+    return true;
+  };
+  const Clock::time_point start = Clock::now();
+  double rangeSeconds = 0.0;
+  bool ok = false;
+  if (raw) {
+    ok = exportRawStrips(&job.params, s, job.output, progress);
+  } else {
+    if (!job.range) job.range = estimateRange(&job.params, s);
+    rangeSeconds = secondsSince(start);
+    std::vector<ColorVariant> variants(1);
+    variants[0].lut = std::move(lut);
+    variants[0].useLog = job.log;
+    variants[0].offset = job.offset;
+    variants[0].fname = job.output;
+    ok = exportColorStrips(&job.params, s, variants, job.range->first,
+                           job.range->second, progress);
+  }
+  const double seconds = secondsSince(start);
+  if (!quiet) std::fputc('\n', stderr);
+  if (tracer.enabled() && !tracer.stop()) {
+    std::fprintf(stderr, "can not write %s\n", trace.c_str());
+  }
+  if (!ok) {
+    std::fprintf(stderr, "export to '%s' failed\n", job.output.c_str());
+    return 1;
+  }
+
+  const double pixels = static_cast<double>(s.W) * s.H;
+  std::printf("%s: %dx%d, %d workers, %s\n", job.output.c_str(), s.W, s.H,
+              scheduler.workerCount(),
+              isaName(familyIsa(job.params.fractal_family)));
+  if (!raw) {
+    std::printf("  range   %9.3f s  [%g, %g]\n", rangeSeconds,
+                job.range->first, job.range->second);
+  }
+  std::printf("  render  %9.3f s  %.2f Mpx/s\n", seconds - rangeSeconds,
+              pixels / (seconds - rangeSeconds) / 1e6);
+  std::printf("  total   %9.3f s\n", seconds);
+  return 0;
+}
@@ -0,0 +1,455 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QRegularExpression>
+#include <QResizeEvent>
+#include <QTextStream>
+#include <QTimer>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "display_widget.h"
+#include "renderjob.h"
+#include "renderscheduler.h"
+
+namespace {
+
+// Zooms into the seahorse valley of the default Julia set, pans around and
+// edits some parameters.
+const char kDefaultScript[] = R"(resize 1280 800
+settle
+wheel 120 8 16
+settle
+drag -240 120 12 16
+settle
+key plus 4 100
+settle
+param max_iterations 1000
+settle
+param family 2
+param n 3
+settle
+colormap gpHot
+log 1
+settle
+key minus 6 30
+settle
+)";
+
+const std::map<QString, Qt::Key> kKeys = {
+    {"plus", Qt::Key_Plus}, {"minus", Qt::Key_Minus}, {"left", Qt::Key_Left},
+    {"right", Qt::Key_Right}, {"up", Qt::Key_Up},     {"down", Qt::Key_Down},
+};
+
+struct Stats {
+  std::vector<double> first;  // ms from the input to the next painted frame
+  std::vector<double> final;  // ms from the input to the rendered image
+  int unsettled = 0;          // no rendered image before the timeout
+};
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * v.size()));
+  return v[std::clamp<size_t>(rank, 1, v.size()) - 1];
+}
+
+// Writes what the user does on the widget as a script for the harness, with
+// the pauses between the inputs.
+class Recorder : public QObject {
+ public:
+  explicit Recorder(QTextStream *out) : out_(out) { clock_.start(); }
+
+  bool eventFilter(QObject *watched, QEvent *event) override {
+    switch (event->type()) {
+      case QEvent::Wheel:
+        line(QString("wheel %1").arg(
+            static_cast<QWheelEvent *>(event)->angleDelta().y()));
+        break;
+      case QEvent::KeyPress: {
+        const int key = static_cast<QKeyEvent *>(event)->key();
+        for (const auto &[name, value] : kKeys) {
+          if (value == key) line("key " + name);
+        }
+        break;
+      }
+      case QEvent::MouseButtonPress:
+        dragStart_ = static_cast<QMouseEvent *>(event)->position().toPoint();
+        dragTime_ = clock_.elapsed();
+        dragSteps_ = 0;
+        break;
+      case QEvent::MouseMove:
+        ++dragSteps_;
+        break;
+      case QEvent::MouseButtonRelease: {
+        const QPoint d =
+            static_cast<QMouseEvent *>(event)->position().toPoint() -
+            dragStart_;
+        const qint64 interval =
+            (clock_.elapsed() - dragTime_) / std::max(dragSteps_, 1);
+        line(QString("drag %1 %2 %3 %4")
+                 .arg(d.x())
+                 .arg(d.y())
+                 .arg(std::max(dragSteps_, 1))
+                 .arg(interval),
+             dragTime_);
+        break;
+      }
+      case QEvent::Resize: {
+        const QSize size = static_cast<QResizeEvent *>(event)->size();
+        line(QString("resize %1 %2").arg(size.width()).arg(size.height()));
+        break;
+      }
+      default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+  }
+
+ private:
+  void line(const QString &text, qint64 time = -1) {
+    if (time < 0) time = clock_.elapsed();
+    if (time > last_) *out_ << "wait " << time - last_ << "\n";
+    *out_ << text << "\n";
+    out_->flush();
+    last_ = clock_.elapsed();
+  }
+
+  QTextStream *out_;
+  QElapsedTimer clock_;
+  qint64 last_ = 0;
+  QPoint dragStart_;
+  qint64 dragTime_ = 0;
+  int dragSteps_ = 0;
+};
+
+}  // namespace
+
+// Replays scripted inputs on a DisplayWidget and measures how long each one
+// takes to show up: until the next painted frame (usually the scaled preview
+// of the last image) and until the frame with the rendered image of the new
+// view. Inputs sent while a render is running all end with the same final
+// frame, like what the user sees.
+class LatencyHarness {
+ public:
+  LatencyHarness(DisplayWidget *widget, int timeoutMs)
+      : w_(widget), timeoutMs_(timeoutMs) {
+    // The parameters MainWindow starts with.
+    w_->fractalParams = RenderJob().params;
+    QObject::connect(w_, &DisplayWidget::framePainted,
+                     [this](bool complete) { painted(complete); });
+    clock_.start();
+  }
+
+  bool run(const QString &script, QString *error) {
+    const QStringList lines = script.split('\n');
+    for (int n = 0; n < lines.size(); ++n) {
+      const QString line = lines[n].section('#', 0, 0).trimmed();
+      if (line.isEmpty()) continue;
+      if (!command(line.split(QRegularExpression("\\s+")))) {
+        *error = QString("line %1: bad command '%2'").arg(n + 1).arg(line);
+        return false;
+      }
+    }
+    settle();
+    return true;
+  }
+
+  // Shows the widget and waits for its first image.
+  void start() {
+    input("show", [this] { w_->show(); });
+    settle();
+  }
+
+  const std::map<QString, Stats> &stats() const { return stats_; }
+
+ private:
+  struct Pending {
+    QString kind;
+    qint64 time;  // ns
+    bool painted;
+  };
+
+  // The arguments from `first` on as numbers.
+  static bool numbers(const QStringList &args, int first,
+                      std::vector<double> *v) {
+    for (int i = first; i < args.size(); ++i) {
+      bool ok = false;
+      v->push_back(args[i].toDouble(&ok));
+      if (!ok) return false;
+    }
+    return true;
+  }
+
+  bool command(const QStringList &args) {
+    const QString &cmd = args[0];
+    const bool named = cmd == "key" || cmd == "colormap" || cmd == "param";
+    if (named && args.size() < 2) return false;
+    std::vector<double> v;
+    if (!numbers(args, named ? 2 : 1, &v)) return false;
+    auto at = [&v](size_t i, double fallback) {
+      return i < v.size() ? v[i] : fallback;
+    };
+
+    if (cmd == "wait" && v.size() == 1) {
+      wait(v[0]);
+    } else if (cmd == "settle" && v.empty()) {
+      settle();
+    } else if (cmd == "resize" && v.size() == 2) {
+      input(cmd, [&] { w_->resize(v[0], v[1]); });
+    } else if (cmd == "wheel" && v.size() >= 1 && v.size() <= 3) {
+      const QPointF pos(w_->width() / 2.0, w_->height() / 2.0);
+      repeat(at(1, 1), at(2, 16), [&] {
+        QWheelEvent event(pos, w_->mapToGlobal(pos), QPoint(),
+                          QPoint(0, v[0]), Qt::NoButton, Qt::NoModifier,
+                          Qt::NoScrollPhase, false);
+        input(cmd, [&] { QCoreApplication::sendEvent(w_, &event); });
+      });
+    } else if (cmd == "key" && v.size() <= 2 && kKeys.count(args[1])) {
+      repeat(at(0, 1), at(1, 16), [&] {
+        QKeyEvent event(QEvent::KeyPress, kKeys.at(args[1]), Qt::NoModifier);
+        input(cmd, [&] { QCoreApplication::sendEvent(w_, &event); });
+      });
+    } else if (cmd == "drag" && v.size() >= 2 && v.size() <= 4) {
+      drag(v[0], v[1], std::max(at(2, 10), 1.0), at(3, 16));
+    } else if (cmd == "param") {
+      return param(args[1], v);
+    } else if (cmd == "colormap" && v.empty()) {
+      const auto presets = ColorMapper::presetNames();
+      if (!presets.contains(args[1])) return false;
+      input(cmd, [&] { w_->setColorMap(presets[args[1]]); });
+    } else if (cmd == "log" && v.size() == 1) {
+      input(cmd, [&] { w_->setLogScale(v[0] != 0); });
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Same names as the keys of the parameter files.
+  bool param(const QString &name, const std::vector<double> &v) {
+    FractalParameters &p = w_->fractalParams;
+    std::function<void()> apply;
+    if (v.size() == 1) {
+      if (name == "family") {
+        apply = [&] { p.fractal_family = v[0]; };
+      } else if (name == "n") {
+        apply = [&] { p.n = v[0]; };
+      } else if (name == "max_iterations") {
+        apply = [&] { p.max_iterations = v[0]; };
+      } else if (name == "max_norm") {
+        apply = [&] { p.max_norm = v[0]; };
+      } else if (name == "mandelbrot") {
+        apply = [&] { p.mandelbrot = v[0] != 0; };
+      } else if (name == "orbit_trap") {
+        apply = [&] { p.orbit_trap = v[0] != 0; };
+      } else if (name == "orbit_mode") {
+        apply = [&] { p.orbit_mode = v[0]; };
+      }
+    } else if (v.size() == 2) {
+      if (name == "c") {
+        apply = [&] { p.c = {v[0], v[1]}; };
+      } else if (name == "q") {
+        apply = [&] { p.q = {v[0], v[1]}; };
+      } else if (name == "orbit_pt") {
+        apply = [&] { p.orbit_pt = {v[0], v[1]}; };
+      }
+    }
+    if (!apply) return false;
+    input("param", [&] {
+      apply();
+      w_->RenderCommand();
+    });
+    return true;
+  }
+
+  void drag(int dx, int dy, int steps, int intervalMs) {
+    const QPointF start(w_->width() / 2.0, w_->height() / 2.0);
+    auto send = [this, start](QEvent::Type type, QPointF pos,
+                              Qt::MouseButton button, Qt::MouseButtons buttons,
+                              const QString &kind) {
+      pos += start;
+      QMouseEvent event(type, pos, w_->mapToGlobal(pos), button, buttons,
+                        Qt::NoModifier);
+      if (kind.isEmpty()) {
+        QCoreApplication::sendEvent(w_, &event);
+      } else {
+        input(kind, [&] { QCoreApplication::sendEvent(w_, &event); });
+      }
+    };
+    // Pressing shows nothing, the moves and the release are the inputs.
+    send(QEvent::MouseButtonPress, {}, Qt::LeftButton, Qt::LeftButton, {});
+    for (int i = 1; i <= steps; ++i) {
+      wait(intervalMs);
+      send(QEvent::MouseMove, QPointF(dx * i / steps, dy * i / steps),
+           Qt::NoButton, Qt::LeftButton, "drag");
+    }
+    send(QEvent::MouseButtonRelease, QPointF(dx, dy), Qt::LeftButton,
+         Qt::NoButton, "release");
+  }
+
+  void repeat(int count, int intervalMs, const std::function<void()> &once) {
+    for (int i = 0; i < count; ++i) {
+      if (i > 0) wait(intervalMs);
+      once();
+    }
+  }
+
+  void input(const QString &kind, const std::function<void()> &send) {
+    pending_.push_back({kind, clock_.nsecsElapsed(), false});
+    send();
+  }
+
+  void painted(bool complete) {
+    const qint64 now = clock_.nsecsElapsed();
+    for (Pending &p : pending_) {
+      if (!p.painted) stats_[p.kind].first.push_back((now - p.time) / 1e6);
+      p.painted = true;
+      if (complete) stats_[p.kind].final.push_back((now - p.time) / 1e6);
+    }
+    if (complete) pending_.clear();
+    if (loop_ && pending_.empty()) loop_->quit();
+  }
+
+  // Processes events, painting included, for `ms`.
+  void wait(int ms) {
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+    loop.exec();
+  }
+
+  // Until the rendered image of the pending inputs is painted.
+  void settle() {
+    if (pending_.empty()) return;
+    QEventLoop loop;
+    loop_ = &loop;
+    QTimer::singleShot(timeoutMs_, &loop, &QEventLoop::quit);
+    loop.exec();
+    loop_ = nullptr;
+    for (const Pending &p : pending_) ++stats_[p.kind].unsettled;
+    pending_.clear();
+  }
+
+  DisplayWidget *w_;
+  int timeoutMs_;
+  QElapsedTimer clock_;
+  std::vector<Pending> pending_;
+  std::map<QString, Stats> stats_;
+  QEventLoop *loop_ = nullptr;
+};
+
+namespace {
+
+void printStats(FILE *out, const std::map<QString, Stats> &stats) {
+  std::fprintf(out, "{\n  \"latency_ms\": {");
+  bool first = true;
+  for (const auto &[kind, s] : stats) {
+    std::fprintf(out, "%s\n    \"%s\": {\"inputs\": %zu, \"unsettled\": %d",
+                 first ? "" : ",", qPrintable(kind), s.first.size(),
+                 s.unsettled);
+    for (const auto &[name, values] :
+         {std::make_pair("first_pixel", &s.first),
+          std::make_pair("final_frame", &s.final)}) {
+      std::fprintf(out,
+                   ", \"%s\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+                   "\"max\": %.3f}",
+                   name, percentile(*values, 50), percentile(*values, 90),
+                   percentile(*values, 99), percentile(*values, 100));
+    }
+    std::fprintf(out, "}");
+    first = false;
+  }
+  std::fprintf(out, "\n  }\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  // Offscreen unless recording, which needs a window to interact with.
+  bool record = false;
+  for (int i = 1; i < argc; ++i) record |= qstrcmp(argv[i], "--record") == 0;
+  if (!record && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Replays zoom, pan and parameter edits on the fractal view and reports "
+      "the input to first pixel and input to final frame latencies as JSON.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("script", "Script to replay, a built-in one "
+                                         "when not given.");
+  const QCommandLineOption output("o", "JSON file, stdout by default.",
+                                  "file");
+  const QCommandLineOption recordFile(
+      "record", "Shows the view and writes what you do as a script.", "file");
+  const QCommandLineOption repeat("repeat", "Replays the script N times.",
+                                  "N", "1");
+  const QCommandLineOption threads(
+      "threads", "Render workers, one per allowed CPU by default.", "count");
+  const QCommandLineOption timeout(
+      "timeout", "Longest wait for a rendered frame, in ms.", "ms", "10000");
+  parser.addOptions({output, recordFile, repeat, threads, timeout});
+  parser.process(app);
+
+  SchedulerSettings settings;
+  settings.workers = parser.value(threads).toInt();
+  RenderScheduler::instance().configure(settings);
+
+  DisplayWidget widget;
+  widget.resize(1280, 800);
+  LatencyHarness harness(&widget, parser.value(timeout).toInt());
+  if (parser.isSet(recordFile)) {
+    QFile file(parser.value(recordFile));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+      qCritical("Can not create %s", qPrintable(file.fileName()));
+      return 1;
+    }
+    QTextStream stream(&file);
+    Recorder recorder(&stream);
+    widget.installEventFilter(&recorder);
+    widget.show();
+    return app.exec();
+  }
+
+  QString script = kDefaultScript;
+  if (!parser.positionalArguments().isEmpty()) {
+    QFile file(parser.positionalArguments()[0]);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      qCritical("Can not open %s", qPrintable(file.fileName()));
+      return 1;
+    }
+    script = QString::fromUtf8(file.readAll());
+  }
+
+  harness.start();
+  QString error;
+  for (int r = 0; r < parser.value(repeat).toInt(); ++r) {
+    if (!harness.run(script, &error)) {
+      qCritical("%s", qPrintable(error));
+      return 1;
+    }
+  }
+
+  FILE *out = stdout;
+  if (parser.isSet(output)) {
+    out = std::fopen(qPrintable(parser.value(output)), "w");
+    if (!out) {
+      qCritical("Can not create %s", qPrintable(parser.value(output)));
+      return 1;
+    }
+  }
+  printStats(out, harness.stats());
+  if (out != stdout) std::fclose(out);
+  return 0;
+}
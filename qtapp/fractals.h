@@ -1,12 +1,11 @@
 #ifndef FRACTALS_H
 #define FRACTALS_H
-#include <QDebug>
-#include <QRectF>
-#include <QSize>
 #include <complex>
 #include <functional>
 #include <memory>
 
+#include "newtonroots.h"
+
 using dbltype = double;
 using cmplx = std::complex<dbltype>;
 
@@ -24,16 +23,23 @@ struct FractalParameters {
   int fractal_family = 0;
 
   // renbder
-  QSize image_size;
+  int image_width = 0;
+  int image_height = 0;
   double centerX, centerY;
   double scale;
 };
 
 class Fractal {
  public:
-    static std::unique_ptr<Fractal> Create(const FractalParameters *params);
+    // The family of `params`, or with `plan` the cheapest implementation that
+    // gives the same values bit for bit, e.g. Quadratic for Family00 with
+    // Re(Q) = 0, and with the shortcuts of the families, like the early exit
+    // of Family03 near a root. Without it the families iterate as written.
+    static std::unique_ptr<Fractal> Create(const FractalParameters *params,
+                                           bool plan = true);
 
  protected:
+  bool plan_ = true;  // of Create(), set before Init()
   cmplx orbit_pt_;
   dbltype th_norm_;
   dbltype radius_;
@@ -149,6 +155,11 @@ class Fractal {
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const = 0;
   std::function<double(const cmplx &z)> GetCouloringFunction(bool mandelbrot,
                                                              int orbit_trap);
+  // out[j] = coloring function at (x0 + (k0 + j) * dx, y) for j in [0, n),
+  // the same points as a loop over GetCouloringFunction() gives.
+  virtual void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                            dbltype dx, int k0, int n, dbltype y,
+                            double *out) const;
   static dbltype kEps;
 };
 
@@ -162,6 +173,10 @@ class Family00 : public Fractal {
   virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
   virtual double CalcFinalNormJulia(const cmplx &z) const override final;
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  // The escape time goes through the kernels of kernels.h.
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
 };
 
 class Family01 : public Fractal {
@@ -173,6 +188,9 @@ class Family01 : public Fractal {
   virtual double CalcFinalNormJulia(const cmplx &z) const override final;
   virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
 };
 
 class Family02 : public Fractal {
@@ -186,6 +204,10 @@ class Family02 : public Fractal {
   virtual double CalcFinalNormJulia(const cmplx &z) const override final;
   virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  // The escape time of the powers 3 to 6 goes through kernels.h.
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
 
   static void FastPow1Inline(dbltype &, dbltype &) {};
   static void FastPow2Inline(dbltype &x, dbltype &y);
@@ -196,11 +218,36 @@ class Family02 : public Fractal {
   static void FastPowNInline(dbltype &x, dbltype &y, const int n);
 };
 
+// z = z^2 + C, what Family00 with Re(Q) = 0 and Family02 with n = 2 reduce
+// to. The operations are those of the families in the same order, without
+// the divisions of Family00 and the std::pow() of Family02.
+class Quadratic : public Fractal {
+  cmplx c_;
+  int family_;
+  // Where the escape time of Mandelbrot orbits starts: at 0 with count 0 for
+  // Family00, at C with count 1 for Family02.
+  cmplx z0_;
+  int it0_;
+
+ public:
+  void Init(const FractalParameters &p) override final;
+  virtual double CalcEscapeJulia(const cmplx &z) const override final;
+  virtual double CalcFinalNormJulia(const cmplx &z) const override final;
+  virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
+  virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
+};
+
 class Family03 : public Fractal {
   cmplx c_;
   int n_;
   std::function<void(dbltype &, dbltype &)> funct_;
   dbltype alpha_;
+  // The escape time stops as soon as its count is certain near a root, empty
+  // without the plan of Create().
+  NewtonRoots roots_;
 
  public:
   void Init(const FractalParameters &p) override final;
@@ -208,6 +255,10 @@ class Family03 : public Fractal {
   virtual double CalcFinalNormJulia(const cmplx &z) const override final;
   virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  // The escape time of the powers 2 to 7 goes through kernels.h.
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
 };
 
 class Family04 : public Fractal {
@@ -215,6 +266,9 @@ class Family04 : public Fractal {
   int n_;
   std::function<void(dbltype &, dbltype &)> funct_;
   dbltype alpha_;
+  // Of the Julia sets, the roots of the Mandelbrot ones change per pixel.
+  // Empty without the plan of Create().
+  NewtonRoots roots_;
 
  public:
   void Init(const FractalParameters &p) override final;
@@ -222,6 +276,10 @@ class Family04 : public Fractal {
   virtual double CalcFinalNormJulia(const cmplx &z) const override final;
   virtual double CalcEscapeMandelbrot(const cmplx &c) const override final;
   virtual double CalcFinalNormMandelbrot(const cmplx &c) const override final;
+  // The escape time of the powers 2 to 7 goes through kernels.h.
+  void EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0, dbltype dx,
+                    int k0, int n, dbltype y,
+                    double *out) const override final;
 };
 
 #endif  // FRACTALS_H
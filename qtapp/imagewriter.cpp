@@ -0,0 +1,332 @@
+#include "imagewriter.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "renderscheduler.h"
+
+namespace {
+
+constexpr uint64_t kBigTiffHeaderSize = 16;
+constexpr uint64_t kTiffStripSize = 1 << 20;
+constexpr size_t kPngChunkSize = 1 << 20;  // raw bytes deflated per task
+
+std::string lowerExtension(const std::string &fname) {
+  const auto dot = fname.find_last_of('.');
+  if (dot == std::string::npos) return {};
+  std::string ext = fname.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return ext;
+}
+
+// TIFF is written little endian regardless of the host.
+void putLE(std::vector<unsigned char> &buf, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) buf.push_back((v >> (8 * i)) & 0xff);
+}
+
+// PNG (and zlib) integers are big endian.
+void putBE(std::vector<unsigned char> &buf, uint64_t v, int bytes) {
+  for (int i = bytes - 1; i >= 0; --i) buf.push_back((v >> (8 * i)) & 0xff);
+}
+
+// Raw deflate of `size` bytes, ending with a sync flush (or the final block
+// when `last`), so the output can be appended to the previous chunks. Returns
+// false when zlib fails, e.g. out of memory.
+bool deflateChunk(const unsigned char *data, size_t size, bool last,
+                  std::vector<unsigned char> *out) {
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&zs, size) + 16);
+  zs.next_in = const_cast<unsigned char *>(data);
+  zs.avail_in = size;
+  zs.next_out = out->data();
+  zs.avail_out = out->size();
+  // All the input fits in the output, so the stream ends or is flushed in
+  // one call.
+  const int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+  const bool ok = (last ? ret == Z_STREAM_END : ret == Z_OK) &&
+                  zs.avail_in == 0;
+  out->resize(zs.total_out);
+  deflateEnd(&zs);
+  return ok;
+}
+
+}  // namespace
+
+std::unique_ptr<StripImageWriter> StripImageWriter::New(
+    const std::string &fname, uint32_t width, uint32_t height) {
+  const std::string ext = lowerExtension(fname);
+  std::unique_ptr<StripImageWriter> result;
+  if (ext == "png") {
+    result.reset(new PngWriter(width, height));
+  } else if (ext == "tif" || ext == "tiff") {
+    result.reset(new BigTiffWriter(width, height));
+  } else if (ext == "ppm") {
+    result.reset(new PpmWriter(width, height));
+  }
+  return result;
+}
+
+std::unique_ptr<StripImageWriter> StripImageWriter::Create(
+    const std::string &fname, uint32_t width, uint32_t height) {
+  auto result = New(fname, width, height);
+  if (!result) return result;
+  result->ofile_.open(fname, std::ios::binary | std::ios::trunc);
+  if (!result->ofile_) return nullptr;
+  result->writeHeader();
+  return result;
+}
+
+std::unique_ptr<StripImageWriter> StripImageWriter::Resume(
+    const std::string &fname, uint32_t width, uint32_t height,
+    const Checkpoint &cp) {
+  auto result = New(fname, width, height);
+  if (!result) return result;
+  std::error_code ec;
+  if (std::filesystem::file_size(fname, ec) < cp.bytes || ec) return nullptr;
+  std::filesystem::resize_file(fname, cp.bytes, ec);
+  if (ec) return nullptr;
+  result->ofile_.open(fname, std::ios::binary | std::ios::in | std::ios::out);
+  if (!result->ofile_) return nullptr;
+  result->ofile_.seekp(0, std::ios::end);
+  result->rows_written_ = cp.rows;
+  result->restore(cp.state);
+  return result;
+}
+
+StripImageWriter::Checkpoint StripImageWriter::checkpoint() {
+  ofile_.flush();
+  Checkpoint cp;
+  cp.rows = rows_written_;
+  cp.bytes = static_cast<uint64_t>(ofile_.tellp());
+  cp.state = state();
+  return cp;
+}
+
+bool StripImageWriter::isSupported(const std::string &fname) {
+  const std::string ext = lowerExtension(fname);
+  return ext == "png" || ext == "tif" || ext == "tiff" || ext == "ppm";
+}
+
+void StripImageWriter::toRgb(const uint32_t *argb, uint32_t rows) {
+  const size_t n = static_cast<size_t>(rows) * width_;
+  rgb_.resize(3 * n);
+  unsigned char *d = rgb_.data();
+  for (size_t i = 0; i < n; ++i) {
+    d[3 * i] = (argb[i] >> 16) & 0xff;
+    d[3 * i + 1] = (argb[i] >> 8) & 0xff;
+    d[3 * i + 2] = argb[i] & 0xff;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PpmWriter::writeHeader() {
+  ofile_ << "P6\n" << width_ << " " << height_ << "\n255\n";
+}
+
+bool PpmWriter::writeRows(const uint32_t *argb, uint32_t rows) {
+  rows = std::min(rows, height_ - rows_written_);
+  toRgb(argb, rows);
+  ofile_.write(reinterpret_cast<const char *>(rgb_.data()), rgb_.size());
+  rows_written_ += rows;
+  return bool(ofile_);
+}
+
+bool PpmWriter::close() {
+  ofile_.close();
+  return !ofile_.fail() && rows_written_ == height_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BigTiffWriter::writeHeader() {
+  std::vector<unsigned char> header{'I', 'I'};
+  putLE(header, 43, 2);  // BigTIFF
+  putLE(header, 8, 2);   // offset size
+  putLE(header, 0, 2);
+  putLE(header, 0, 8);  // first IFD, patched by close()
+  ofile_.write(reinterpret_cast<const char *>(header.data()), header.size());
+}
+
+bool BigTiffWriter::writeRows(const uint32_t *argb, uint32_t rows) {
+  rows = std::min(rows, height_ - rows_written_);
+  toRgb(argb, rows);
+  ofile_.write(reinterpret_cast<const char *>(rgb_.data()), rgb_.size());
+  rows_written_ += rows;
+  return bool(ofile_);
+}
+
+bool BigTiffWriter::close() {
+  if (!ofile_.is_open()) return false;
+  if (rows_written_ != height_) {
+    ofile_.close();
+    return false;
+  }
+  const uint64_t row_bytes = 3ull * width_;
+  const uint64_t rows_per_strip =
+      std::clamp<uint64_t>(kTiffStripSize / row_bytes, 1, height_);
+  const uint64_t nstrips = (height_ + rows_per_strip - 1) / rows_per_strip;
+
+  // Strip tables go after the pixel data, the IFD after them. TIFF wants the
+  // IFD on a word boundary, the pixels are padded to 8 bytes.
+  const uint64_t data_end = kBigTiffHeaderSize + row_bytes * height_;
+  const uint64_t offsets_pos = (data_end + 7) & ~uint64_t{7};
+  const uint64_t counts_pos = offsets_pos + 8 * nstrips;
+  const uint64_t ifd_pos = counts_pos + 8 * nstrips;
+
+  std::vector<unsigned char> buf(offsets_pos - data_end, 0);
+  for (uint64_t s = 0; s < nstrips; ++s) {
+    putLE(buf, kBigTiffHeaderSize + s * rows_per_strip * row_bytes, 8);
+  }
+  for (uint64_t s = 0; s < nstrips; ++s) {
+    const uint64_t rows = std::min(rows_per_strip, height_ - s * rows_per_strip);
+    putLE(buf, rows * row_bytes, 8);
+  }
+
+  enum : uint16_t { kShort = 3, kLong = 4, kLong8 = 16 };
+  auto entry = [&buf](uint16_t tag, uint16_t type, uint64_t count,
+                      uint64_t value) {
+    putLE(buf, tag, 2);
+    putLE(buf, type, 2);
+    putLE(buf, count, 8);
+    putLE(buf, value, 8);
+  };
+  // With a single strip the table fits in the entry itself.
+  const uint64_t offsets = nstrips == 1 ? kBigTiffHeaderSize : offsets_pos;
+  const uint64_t counts = nstrips == 1 ? row_bytes * height_ : counts_pos;
+
+  putLE(buf, 10, 8);
+  entry(256, kLong, 1, width_);                  // ImageWidth
+  entry(257, kLong, 1, height_);                 // ImageLength
+  entry(258, kShort, 3, 0x0000000800080008ull);  // BitsPerSample 8,8,8
+  entry(259, kShort, 1, 1);                      // no compression
+  entry(262, kShort, 1, 2);                      // RGB
+  entry(273, kLong8, nstrips, offsets);          // StripOffsets
+  entry(277, kShort, 1, 3);                      // SamplesPerPixel
+  entry(278, kLong, 1, rows_per_strip);          // RowsPerStrip
+  entry(279, kLong8, nstrips, counts);           // StripByteCounts
+  entry(284, kShort, 1, 1);                      // PlanarConfiguration
+  putLE(buf, 0, 8);
+
+  ofile_.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+  buf.clear();
+  putLE(buf, ifd_pos, 8);
+  ofile_.seekp(8);
+  ofile_.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+  ofile_.close();
+  return !ofile_.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PngWriter::writeHeader() {
+  const unsigned char signature[8] = {137, 'P',  'N', 'G',
+                                      '\r', '\n', 26,  '\n'};
+  ofile_.write(reinterpret_cast<const char *>(signature), 8);
+
+  std::vector<unsigned char> ihdr;
+  putBE(ihdr, width_, 4);
+  putBE(ihdr, height_, 4);
+  ihdr.push_back(8);  // bit depth
+  ihdr.push_back(2);  // RGB
+  ihdr.push_back(0);  // deflate
+  ihdr.push_back(0);  // adaptive filtering
+  ihdr.push_back(0);  // no interlace
+  writeChunk("IHDR", ihdr.data(), ihdr.size());
+}
+
+void PngWriter::restore(uint64_t state) {
+  adler_ = state;
+  stream_started_ = rows_written_ > 0;
+}
+
+void PngWriter::writeChunk(const char *type, const unsigned char *data,
+                           size_t size) {
+  std::vector<unsigned char> buf;
+  putBE(buf, size, 4);
+  buf.insert(buf.end(), type, type + 4);
+  uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+  if (size > 0) crc = crc32(crc, data, size);
+  ofile_.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+  ofile_.write(reinterpret_cast<const char *>(data), size);
+  buf.clear();
+  putBE(buf, crc, 4);
+  ofile_.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+}
+
+bool PngWriter::writeRows(const uint32_t *argb, uint32_t rows) {
+  rows = std::min(rows, height_ - rows_written_);
+  if (rows == 0) return bool(ofile_);
+
+  // Scanlines with the Sub filter, which only depends on the row itself.
+  const size_t line = 3 * static_cast<size_t>(width_) + 1;
+  rgb_.resize(line * rows);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, static_cast<int>(rows), [&](int i) {
+        const uint32_t *src = argb + static_cast<size_t>(i) * width_;
+        unsigned char *d = &rgb_[i * line];
+        d[0] = 1;
+        unsigned char prev[3] = {0, 0, 0};
+        for (uint32_t k = 0; k < width_; ++k) {
+          const unsigned char px[3] = {static_cast<unsigned char>(src[k] >> 16),
+                                       static_cast<unsigned char>(src[k] >> 8),
+                                       static_cast<unsigned char>(src[k])};
+          for (int c = 0; c < 3; ++c) {
+            d[1 + 3 * k + c] = px[c] - prev[c];
+            prev[c] = px[c];
+          }
+        }
+      });
+
+  const bool last = rows_written_ + rows == height_;
+  const size_t chunk_rows = std::max<size_t>(1, kPngChunkSize / line);
+  const size_t nchunks = (rows + chunk_rows - 1) / chunk_rows;
+  std::vector<std::vector<unsigned char>> compressed(nchunks);
+  std::vector<unsigned long> adlers(nchunks);
+  std::vector<char> deflated(nchunks);
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, 0, static_cast<int>(nchunks), [&](int i) {
+        const size_t c = i;
+        const size_t begin = c * chunk_rows * line;
+        const size_t size = std::min(chunk_rows * line, rgb_.size() - begin);
+        const unsigned char *data = rgb_.data() + begin;
+        deflated[c] = deflateChunk(data, size, last && c + 1 == nchunks,
+                                   &compressed[c]);
+        adlers[c] = adler32(adler32(0, nullptr, 0), data, size);
+      });
+  // A failed chunk would leave a corrupt stream, nothing is written and the
+  // file is not complete.
+  if (std::count(deflated.begin(), deflated.end(), 0) > 0) {
+    failed_ = true;
+    return false;
+  }
+
+  for (size_t c = 0; c < nchunks; ++c) {
+    const size_t size =
+        std::min(chunk_rows * line, rgb_.size() - c * chunk_rows * line);
+    adler_ = adler32_combine(adler_, adlers[c], size);
+
+    std::vector<unsigned char> &data = compressed[c];
+    if (!stream_started_) {
+      data.insert(data.begin(), {0x78, 0x9c});  // zlib header
+      stream_started_ = true;
+    }
+    if (last && c + 1 == nchunks) putBE(data, adler_, 4);
+    writeChunk("IDAT", data.data(), data.size());
+  }
+  rows_written_ += rows;
+  return bool(ofile_);
+}
+
+bool PngWriter::close() {
+  if (!ofile_.is_open()) return false;
+  const bool complete = rows_written_ == height_ && !failed_;
+  if (complete) writeChunk("IEND", nullptr, 0);
+  ofile_.close();
+  return complete && !ofile_.fail();
+}
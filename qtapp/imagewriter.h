@@ -0,0 +1,108 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Sequential writer for images too big to be held in memory. Rows are given
+// top to bottom as 0xAARRGGBB pixels (QRgb layout) and stored as 8 bit RGB.
+class StripImageWriter {
+ public:
+  // What is needed to continue a file after writeRows() was last called.
+  struct Checkpoint {
+    uint32_t rows = 0;
+    uint64_t bytes = 0;
+    uint64_t state = 0;  // format specific
+  };
+
+  // Picks the format from the file extension (.png -> PNG, .tif/.tiff ->
+  // BigTIFF, .ppm -> PPM). Returns nullptr if the extension is not supported
+  // or the file can not be created.
+  static std::unique_ptr<StripImageWriter> Create(const std::string &fname,
+                                                  uint32_t width,
+                                                  uint32_t height);
+  // Continues a file left at `cp` by an interrupted writer, dropping whatever
+  // was written after it. Returns nullptr if the file can not be opened.
+  static std::unique_ptr<StripImageWriter> Resume(const std::string &fname,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  const Checkpoint &cp);
+  static bool isSupported(const std::string &fname);
+
+  virtual ~StripImageWriter() = default;
+  virtual bool writeRows(const uint32_t *argb, uint32_t rows) = 0;
+  virtual bool close() = 0;
+  // Flushes the file, so the returned checkpoint is on disk.
+  Checkpoint checkpoint();
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+  uint32_t rowsWritten() const { return rows_written_; }
+
+ protected:
+  StripImageWriter(uint32_t width, uint32_t height)
+      : width_(width), height_(height) {}
+  static std::unique_ptr<StripImageWriter> New(const std::string &fname,
+                                               uint32_t width, uint32_t height);
+  virtual void writeHeader() = 0;
+  virtual uint64_t state() const { return 0; }
+  virtual void restore(uint64_t) {}
+  void toRgb(const uint32_t *argb, uint32_t rows);
+
+  std::ofstream ofile_;
+  std::vector<unsigned char> rgb_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t rows_written_{0};
+};
+
+class PpmWriter : public StripImageWriter {
+ public:
+  PpmWriter(uint32_t width, uint32_t height)
+      : StripImageWriter(width, height) {}
+  bool writeRows(const uint32_t *argb, uint32_t rows) override;
+  bool close() override;
+
+ protected:
+  void writeHeader() override;
+};
+
+// Uncompressed, striped BigTIFF. Pixels are written contiguously after the
+// header and close() appends the strip tables and the IFD.
+class BigTiffWriter : public StripImageWriter {
+ public:
+  BigTiffWriter(uint32_t width, uint32_t height)
+      : StripImageWriter(width, height) {}
+  bool writeRows(const uint32_t *argb, uint32_t rows) override;
+  bool close() override;
+
+ protected:
+  void writeHeader() override;
+};
+
+// PNG whose zlib stream is deflated in independent row chunks on all cores.
+// Every chunk but the last ends with a sync flush, so the raw deflate streams
+// can be concatenated, and the adler32 of the chunks is combined at the end.
+class PngWriter : public StripImageWriter {
+ public:
+  PngWriter(uint32_t width, uint32_t height)
+      : StripImageWriter(width, height) {}
+  bool writeRows(const uint32_t *argb, uint32_t rows) override;
+  bool close() override;
+
+ protected:
+  void writeHeader() override;
+  uint64_t state() const override { return adler_; }
+  void restore(uint64_t state) override;
+
+ private:
+  void writeChunk(const char *type, const unsigned char *data, size_t size);
+
+  unsigned long adler_{1};
+  bool stream_started_{false};
+  bool failed_{false};  // zlib failed, the stream is incomplete
+};
+
+#endif  // IMAGEWRITER_H
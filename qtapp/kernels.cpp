@@ -0,0 +1,22 @@
+#include "kernels.h"
+
+extern const Kernels kKernelsSse2;
+#ifdef FRACTALGEN_ISA_VARIANTS
+extern const Kernels kKernelsAvx2;
+extern const Kernels kKernelsAvx512;
+#endif
+
+const Kernels &kernels(Isa isa) {
+  switch (isa) {
+#ifdef FRACTALGEN_ISA_VARIANTS
+    case Isa::Avx512:
+      return kKernelsAvx512;
+    case Isa::Avx2:
+      return kKernelsAvx2;
+#endif
+    default:
+      return kKernelsSse2;
+  }
+}
+
+const Kernels &kernels() { return kernels(activeIsa()); }
@@ -0,0 +1,62 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+#include <cstdint>
+
+#include "cpufeatures.h"
+
+// The escape time loops of the families that vectorize, and the inner loops
+// of the colorizing and the smoothing filter. They are built once per
+// instruction set (kernels_sse2.cpp, kernels_avx2.cpp, kernels_avx512.cpp)
+// from kernels_impl.h, and kernels() returns the build of activeIsa(); the
+// families take the one of familyIsa(), which the tuning may set. All builds
+// give the same results as the scalar code bit for bit: no FMA contraction,
+// and the operations of each pixel in the order of the scalar loops. The
+// pixels are iterated in lockstep with escaped lanes frozen, or for Newton's
+// method with the lanes that end refilled with the next pixels.
+
+class NewtonRoots;
+
+// What the escape time kernels need of a family. The families set the
+// members their kernel uses by name, the others stay 0.
+struct EscapeParams {
+  bool mandelbrot = false;
+  double c_re = 0.0, c_im = 0.0;    // the Julia constant
+  double z0_re = 0.0, z0_im = 0.0;  // start of the Mandelbrot orbits
+  int it0 = 0;                      // and their count there
+  double q = 0.0;                   // Re(Q) of Family00 and Family04
+  int n = 0;  // power of Family02, 2 to 6, of Family03/04, 2 to 7
+  double th_norm = 0.0;
+  int max_iter = 0;
+  // Newton's method of Family03 and Family04, whose orbits all start at
+  // count 1: Im(Q), (n - 1) / n, the step below which it stops, and the
+  // roots that may stop it earlier below NewtonRoots::gate(), null for none.
+  double q_im = 0.0;
+  double alpha = 0.0;
+  double eps = 0.0;
+  const NewtonRoots *roots = nullptr;
+  double gate = 0.0;
+};
+
+// out[j] = escape time at (x0 + (k0 + j) * dx, y) for j in [0, n).
+using EscapeSpanKernel = void (*)(const EscapeParams &p, double x0, double dx,
+                                  int k0, int n, double y, double *out);
+
+struct Kernels {
+  EscapeSpanKernel escape00;
+  EscapeSpanKernel escape01;
+  EscapeSpanKernel escape02;
+  EscapeSpanKernel escape03;
+  EscapeSpanKernel escape04;
+  // ColorLut::colorize() of the values data[i * stride].
+  void (*colorize)(const double *data, int stride, double lower,
+                   double upper, const uint32_t *lut, int levels,
+                   bool periodic, bool logarithmic, uint32_t *out, int n);
+  // out[i] = w * in[i] and out[i] += w * in[i].
+  void (*scale)(double *out, const double *in, double w, int n);
+  void (*addScaled)(double *out, const double *in, double w, int n);
+};
+
+const Kernels &kernels(Isa isa);
+const Kernels &kernels();
+
+#endif  // KERNELS_H
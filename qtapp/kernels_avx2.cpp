@@ -0,0 +1,4 @@
+// The kernels built with -mavx2 -mfma, see CMakeLists.txt.
+#define KERNELS_TABLE kKernelsAvx2
+#define KERNELS_LANES 16
+#include "kernels_impl.h"
@@ -0,0 +1,4 @@
+// The kernels built for AVX-512 F/DQ/VL, see CMakeLists.txt.
+#define KERNELS_TABLE kKernelsAvx512
+#define KERNELS_LANES 32
+#include "kernels_impl.h"
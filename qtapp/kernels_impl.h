@@ -0,0 +1,453 @@
+// The body of kernels_sse2.cpp, kernels_avx2.cpp and kernels_avx512.cpp,
+// compiled with the flags of each instruction set, -ffp-contract=off and
+// -fno-trapping-math. Everything is internal and only uses operators, C
+// functions and NewtonRoots::RemainingSteps(), which is out of line: an inline
+// function of another header would be compiled for this instruction set as
+// well, and the linker could pick that copy for every caller.
+//
+// The including file defines KERNELS_TABLE, the name of its Kernels, and
+// KERNELS_LANES.
+#include <math.h>
+
+#include "kernels.h"
+#include "newtonroots.h"
+
+namespace {
+
+// Pixels iterated together, KERNELS_LANES of the including file: about four
+// vectors, so that there are independent chains to hide the latency of the
+// arithmetic.
+constexpr int kLanes = KERNELS_LANES;
+
+// The orbits of kLanes pixels. Lanes that escaped, and those past the end of
+// the span, keep their values and count. The masks are doubles, 1 or 0, and
+// the kernels have no branches per lane, so that the lane loops vectorize.
+struct Orbits {
+  double x[kLanes], y[kLanes], cr[kLanes], ci[kLanes], it[kLanes];
+  double live[kLanes];
+};
+
+// Lane l is the pixel x0 + (k0 + j0 + l) * dx, like Fractal::EvaluateSpan.
+// Mandelbrot orbits start at p.z0 with count p.it0, Julia ones at the pixel
+// with count 0. Returns the number of pixels.
+int startOrbits(const EscapeParams &p, double x0, double dx, int k0, int j0,
+                int n, double y, Orbits *o) {
+  const int m = n - j0 < kLanes ? n - j0 : kLanes;
+  for (int l = 0; l < kLanes; ++l) {
+    const double px = x0 + (k0 + j0 + l) * dx;
+    if (p.mandelbrot) {
+      o->x[l] = p.z0_re;
+      o->y[l] = p.z0_im;
+      o->cr[l] = px;
+      o->ci[l] = y;
+      o->it[l] = p.it0;
+    } else {
+      o->x[l] = px;
+      o->y[l] = y;
+      o->cr[l] = p.c_re;
+      o->ci[l] = p.c_im;
+      o->it[l] = 0;
+    }
+    o->live[l] = l < m ? 1.0 : 0.0;
+  }
+  return m;
+}
+
+// Family00::CalcEscape*, z = z^2(1 + Qz^2)/(1 - Qz^2) + c with real Q.
+void escape00(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  const double q = p.q;
+  const double q2 = q * q;
+  const double th_norm = p.th_norm;
+  const double max_iter = p.max_iter;
+  for (int j0 = 0; j0 < n; j0 += kLanes) {
+    Orbits o;
+    const int m = startOrbits(p, x0, dx, k0, j0, n, y, &o);
+    for (;;) {
+      double live = 0.0;
+      for (int l = 0; l < kLanes; ++l) {
+        const double x2 = o.x[l] * o.x[l];
+        const double y2 = o.y[l] * o.y[l];
+        const double run = (x2 + y2 >= th_norm ? 0.0 : o.live[l]) *
+                           (o.it[l] >= max_iter ? 0.0 : 1.0);
+        const double zx = x2 - y2;
+        const double zy = 2 * o.x[l] * o.y[l];
+        const double xx = zx * zx;
+        const double yy = zy * zy;
+        const double tmp0 = (xx + yy) * q2;
+        const double dem = tmp0 - 2 * (q * zx) + 1;
+        const double tmp1 = -zx * tmp0 - 2 * q * yy + zx;
+        const double tmp2 = -zy * tmp0 + 2 * q * zx * zy + zy;
+        o.x[l] = run != 0.0 ? tmp1 / dem + o.cr[l] : o.x[l];
+        o.y[l] = run != 0.0 ? tmp2 / dem + o.ci[l] : o.y[l];
+        o.it[l] += run;
+        o.live[l] = run;
+        live += run;
+      }
+      if (live == 0.0) break;
+    }
+    for (int l = 0; l < m; ++l) out[j0 + l] = o.it[l];
+  }
+}
+
+// Family01::CalcEscape*, z = z^2 + c.
+void escape01(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  const double th_norm = p.th_norm;
+  const double max_iter = p.max_iter;
+  for (int j0 = 0; j0 < n; j0 += kLanes) {
+    Orbits o;
+    const int m = startOrbits(p, x0, dx, k0, j0, n, y, &o);
+    for (;;) {
+      double live = 0.0;
+      for (int l = 0; l < kLanes; ++l) {
+        const double x2 = o.x[l] * o.x[l];
+        const double y2 = o.y[l] * o.y[l];
+        const double run = (x2 + y2 >= th_norm ? 0.0 : o.live[l]) *
+                           (o.it[l] >= max_iter ? 0.0 : 1.0);
+        const double nx = x2 + (-y2 + o.cr[l]);
+        const double ny = 2 * o.x[l] * o.y[l] + o.ci[l];
+        o.x[l] = run != 0.0 ? nx : o.x[l];
+        o.y[l] = run != 0.0 ? ny : o.y[l];
+        o.it[l] += run;
+        o.live[l] = run;
+        live += run;
+      }
+      if (live == 0.0) break;
+    }
+    for (int l = 0; l < m; ++l) out[j0 + l] = o.it[l];
+  }
+}
+
+// Family02::FastPow<N>Inline.
+template <int N>
+void power(double &x, double &y) {
+  if (N == 1) {
+    return;
+  } else if (N == 2) {
+    const double x2 = x * x;
+    const double y2 = y * y;
+    y *= 2 * x;
+    x = x2 - y2;
+  } else if (N == 3) {
+    const double xx = x * x;
+    const double yy = y * y;
+    x *= (xx - 3 * yy);
+    y *= (3 * xx - yy);
+  } else if (N == 4) {
+    const double xx = x * x;
+    const double yy = y * y;
+    y *= 4 * x * (xx - yy);
+    x = xx * xx - 6 * xx * yy + yy * yy;
+  } else if (N == 5) {
+    const double x2 = x * x;
+    const double x4 = x2 * x2;
+    const double y2 = y * y;
+    const double y4 = y2 * y2;
+    const double cm = -10 * x2 * y2;
+    x *= (x4 + 5 * y4 + cm);
+    y *= (y4 + 5 * x4 + cm);
+  } else {
+    const double x2 = x * x;
+    const double x4 = x2 * x2;
+    const double y2 = y * y;
+    const double y4 = y2 * y2;
+    y *= x * (6 * x4 - 20.0 * x2 * y2 + 6 * y4);
+    x = x4 * (x2 - 15 * y2) + y4 * (15 * x2 - y2);
+  }
+}
+
+// Family02::CalcEscape*, z = z^N + c, and Quadratic::CalcEscape* with N = 2.
+template <int N>
+void escape02(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  const double th_norm = p.th_norm;
+  const double max_iter = p.max_iter;
+  for (int j0 = 0; j0 < n; j0 += kLanes) {
+    Orbits o;
+    const int m = startOrbits(p, x0, dx, k0, j0, n, y, &o);
+    for (;;) {
+      double live = 0.0;
+      for (int l = 0; l < kLanes; ++l) {
+        double zx = o.x[l];
+        double zy = o.y[l];
+        const double run = (zx * zx + zy * zy >= th_norm ? 0.0 : o.live[l]) *
+                           (o.it[l] >= max_iter ? 0.0 : 1.0);
+        power<N>(zx, zy);
+        o.x[l] = run != 0.0 ? zx + o.cr[l] : o.x[l];
+        o.y[l] = run != 0.0 ? zy + o.ci[l] : o.y[l];
+        o.it[l] += run;
+        o.live[l] = run;
+        live += run;
+      }
+      if (live == 0.0) break;
+    }
+    for (int l = 0; l < m; ++l) out[j0 + l] = o.it[l];
+  }
+}
+
+void escape02(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  switch (p.n) {
+    case 2:
+      escape02<2>(p, x0, dx, k0, n, y, out);
+      break;
+    case 3:
+      escape02<3>(p, x0, dx, k0, n, y, out);
+      break;
+    case 4:
+      escape02<4>(p, x0, dx, k0, n, y, out);
+      break;
+    case 5:
+      escape02<5>(p, x0, dx, k0, n, y, out);
+      break;
+    default:
+      escape02<6>(p, x0, dx, k0, n, y, out);
+      break;
+  }
+}
+
+// The orbits of Newton's method, which end at very different counts: a lane
+// that ends takes the next pixel of the span rather than idling until the
+// slowest lane ends, so the vectors stay full. `event` is 0 for a lane that
+// iterates on, 1 for one that ended and 2 for one whose step is below the
+// gate of the roots.
+struct NewtonLanes {
+  double x[kLanes], y[kLanes], cr[kLanes], ci[kLanes], it[kLanes];
+  double live[kLanes], event[kLanes];
+  int pixel[kLanes];
+};
+
+void startNewton(const EscapeParams &p, double x0, double dx, int k0, int j,
+                 double y, NewtonLanes *o, int l) {
+  const double px = x0 + (k0 + j) * dx;
+  if (p.mandelbrot) {
+    o->x[l] = 0.0;
+    o->y[l] = 0.0;
+    o->cr[l] = px;
+    o->ci[l] = y;
+  } else {
+    o->x[l] = px;
+    o->y[l] = y;
+    o->cr[l] = p.c_re;
+    o->ci[l] = p.c_im;
+  }
+  o->it[l] = 1;
+  o->live[l] = 1.0;
+  o->pixel[l] = j;
+}
+
+// The escape time loops of Family03 and Family04: `step` makes a Newton step
+// of (x, y) with the constant (cr, ci) and returns max(|dx|, |dy|) like
+// std::max(). A lane ends when its count reaches max_iter, when the step is
+// below eps, or when the roots tell the remaining steps, as in the scalar
+// loops.
+template <class Step>
+void newton(const EscapeParams &p, double x0, double dx, int k0, int n,
+            double y, double *out, Step step) {
+  const double max_iter = p.max_iter;
+  const double eps = p.eps;
+  const double gate = p.roots ? p.gate : 0.0;
+  NewtonLanes o;
+  int next = 0;
+  int active = 0;
+  for (int l = 0; l < kLanes; ++l) {
+    if (next < n) {
+      startNewton(p, x0, dx, k0, next++, y, &o, l);
+      ++active;
+    } else {
+      o.x[l] = o.y[l] = o.cr[l] = o.ci[l] = o.it[l] = o.live[l] = 0.0;
+      o.pixel[l] = -1;
+    }
+  }
+  while (active > 0) {
+    double events = 0.0;
+    for (int l = 0; l < kLanes; ++l) {
+      double zx = o.x[l];
+      double zy = o.y[l];
+      const double d = step(zx, zy, o.cr[l], o.ci[l]);
+      const double event =
+          (o.it[l] >= max_iter || d < eps ? 1.0 : d < gate ? 2.0 : 0.0) *
+          o.live[l];
+      o.x[l] = zx;
+      o.y[l] = zy;
+      o.it[l] += event == 0.0 ? 1.0 : 0.0;
+      o.event[l] = event;
+      events += event;
+    }
+    if (events == 0.0) continue;
+    for (int l = 0; l < kLanes; ++l) {
+      if (o.event[l] == 0.0) continue;
+      if (o.event[l] == 2.0) {
+        const int steps = p.roots->RemainingSteps(o.x[l], o.y[l]);
+        if (steps == 0) {
+          o.it[l] += 1.0;
+          continue;
+        }
+        o.it[l] = o.it[l] + steps < max_iter ? o.it[l] + steps : max_iter;
+      }
+      out[o.pixel[l]] = o.it[l];
+      if (next < n) {
+        startNewton(p, x0, dx, k0, next++, y, &o, l);
+      } else {
+        o.live[l] = 0.0;
+        o.pixel[l] = -1;
+        --active;
+      }
+    }
+  }
+}
+
+// Family03::CalcEscapeJulia(), with P = n - 1.
+template <int P>
+void escape03(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  const double nn = p.n;
+  const double alpha = p.alpha;
+  newton(p, x0, dx, k0, n, y, out,
+         [nn, alpha](double &x, double &y, double cr, double ci) {
+           const double x1 = x;
+           const double y1 = y;
+           power<P>(x, y);
+           x *= nn;
+           y *= nn;
+           const double rdem = x * x + y * y;
+           const double x2 = x1 * alpha - (cr * x + ci * y) / rdem;
+           const double y2 = y1 * alpha - (ci * x - cr * y) / rdem;
+           x = x2;
+           y = y2;
+           const double ax = fabs(x1 - x);
+           const double ay = fabs(y1 - y);
+           return ax < ay ? ay : ax;
+         });
+}
+
+// Family04::CalcEscape*(), with P = n - 1.
+template <int P>
+void escape04(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  const double nn = p.n;
+  const double qr = p.q;
+  const double qi = p.q_im;
+  newton(p, x0, dx, k0, n, y, out,
+         [nn, qr, qi](double &x, double &y, double cr, double ci) {
+           const double x1 = x;
+           const double y1 = y;
+           power<P>(x, y);  // z^(n-1)
+           double x2 = x1 * x - y1 * y;
+           double y2 = x1 * y + y1 * x;  // z^n
+           x = nn * x + qr;
+           y = y * nn + qi;
+           const double rdem = x * x + y * y;
+           x2 += x1 * qr - y1 * qi + cr;
+           y2 += x1 * qi + y1 * qr + ci;
+           const double tmp = x1 - (x2 * x + y2 * y) / rdem;
+           y = y1 - (y2 * x - x2 * y) / rdem;
+           x = tmp;
+           const double ax = fabs(x1 - x);
+           const double ay = fabs(y1 - y);
+           return ax < ay ? ay : ax;
+         });
+}
+
+void escape03(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  switch (p.n) {
+    case 2:
+      escape03<1>(p, x0, dx, k0, n, y, out);
+      break;
+    case 3:
+      escape03<2>(p, x0, dx, k0, n, y, out);
+      break;
+    case 4:
+      escape03<3>(p, x0, dx, k0, n, y, out);
+      break;
+    case 5:
+      escape03<4>(p, x0, dx, k0, n, y, out);
+      break;
+    case 6:
+      escape03<5>(p, x0, dx, k0, n, y, out);
+      break;
+    default:
+      escape03<6>(p, x0, dx, k0, n, y, out);
+      break;
+  }
+}
+
+void escape04(const EscapeParams &p, double x0, double dx, int k0, int n,
+              double y, double *out) {
+  switch (p.n) {
+    case 2:
+      escape04<1>(p, x0, dx, k0, n, y, out);
+      break;
+    case 3:
+      escape04<2>(p, x0, dx, k0, n, y, out);
+      break;
+    case 4:
+      escape04<3>(p, x0, dx, k0, n, y, out);
+      break;
+    case 5:
+      escape04<4>(p, x0, dx, k0, n, y, out);
+      break;
+    case 6:
+      escape04<5>(p, x0, dx, k0, n, y, out);
+      break;
+    default:
+      escape04<6>(p, x0, dx, k0, n, y, out);
+      break;
+  }
+}
+
+// The loops of ColorLut::colorize().
+void colorize(const double *data, int stride, double lower, double upper,
+              const uint32_t *lut, int levels, bool periodic,
+              bool logarithmic, uint32_t *out, int n) {
+  if (!logarithmic) {
+    const double posToIndexFactor = (levels - 1) / (upper - lower);
+    if (periodic) {
+      for (int i = 0; i < n; ++i) {
+        int index =
+            (int)((data[stride * i] - lower) * posToIndexFactor) % levels;
+        if (index < 0) index += levels;
+        out[i] = lut[index];
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        int index = (data[stride * i] - lower) * posToIndexFactor;
+        index = index < 0 ? 0 : index >= levels ? levels - 1 : index;
+        out[i] = lut[index];
+      }
+    }
+  } else {
+    const double logRange = log(upper / lower);
+    if (periodic) {
+      for (int i = 0; i < n; ++i) {
+        int index = (int)(log(data[stride * i] / lower) / logRange *
+                          (levels - 1)) %
+                    levels;
+        if (index < 0) index += levels;
+        out[i] = lut[index];
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        int index = log(data[stride * i] / lower) / logRange * (levels - 1);
+        index = index < 0 ? 0 : index >= levels ? levels - 1 : index;
+        out[i] = lut[index];
+      }
+    }
+  }
+}
+
+void scale(double *out, const double *in, double w, int n) {
+  for (int i = 0; i < n; ++i) out[i] = w * in[i];
+}
+
+void addScaled(double *out, const double *in, double w, int n) {
+  for (int i = 0; i < n; ++i) out[i] += w * in[i];
+}
+
+}  // namespace
+
+extern const Kernels KERNELS_TABLE = {escape00, escape01, escape02,
+                                      escape03, escape04, colorize,
+                                      scale,    addScaled};
@@ -0,0 +1,4 @@
+// The baseline build of the kernels, see kernels.h.
+#define KERNELS_TABLE kKernelsSse2
+#define KERNELS_LANES 8
+#include "kernels_impl.h"
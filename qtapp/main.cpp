@@ -1,10 +1,102 @@
 #include <QApplication>
+#include <QCommandLineParser>
 
+#include "autotune.h"
+#include "cpufeatures.h"
 #include "mainwindow.h"
+#include "renderscheduler.h"
+#include "trace.h"
 
 int main(int argc, char *argv[]) {
   QApplication a(argc, argv);
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  const QCommandLineOption threads(
+      "threads", "Render workers, one per allowed CPU by default.", "count");
+  const QCommandLineOption cpus(
+      "cpus", "CPUs the render workers are pinned to, e.g. 0-7,16-23.",
+      "list");
+  const QCommandLineOption numa(
+      "numa", "One worker partition per NUMA node, with node local buffers.");
+  const QCommandLineOption exportWorkers(
+      "export-workers", "Workers that render exports before new frames.",
+      "count");
+  const QCommandLineOption trace(
+      "trace", "Writes a Chrome trace of the render pipeline on exit.",
+      "file");
+  const QCommandLineOption isa(
+      "isa", "Kernels built for sse2, avx2 or avx512, the best of the CPU by "
+             "default.",
+      "name");
+  const QCommandLineOption tune(
+      "tune", "Measures the fastest workers, kernels and tiles again, done on "
+              "the first start.");
+  const QCommandLineOption noTuning(
+      "no-tuning", "Ignores the measured configuration.");
+  parser.addOptions(
+      {threads, cpus, numa, exportWorkers, trace, isa, tune, noTuning});
+  parser.process(a);
+
+  auto &tracer = Tracer::instance();
+  if (parser.isSet(trace)) {
+    if (tracer.start(parser.value(trace).toStdString())) {
+      tracer.setThreadName("gui");
+    } else {
+      qWarning("Can not create the trace file %s",
+               qPrintable(parser.value(trace)));
+    }
+  }
+
+  if (parser.isSet(isa)) {
+    Isa wanted;
+    if (!parseIsa(parser.value(isa).toStdString(), &wanted) ||
+        !setIsa(wanted)) {
+      qWarning("Can not use the instruction set %s, using %s",
+               qPrintable(parser.value(isa)), isaName(activeIsa()));
+    }
+  }
+
+  SchedulerSettings settings;
+  settings.workers = parser.value(threads).toInt();
+  settings.cpus = parseCpuList(parser.value(cpus).toStdString());
+  settings.numa = parser.isSet(numa);
+
+  // The measured configuration, measured now on the first start on a machine.
+  if (!parser.isSet(noTuning) || parser.isSet(tune)) {
+    const std::string tuningFile = defaultTuningFile();
+    TuningProfile profile;
+    std::string error;
+    if (parser.isSet(tune) || !loadTuning(tuningFile, &profile, &error) ||
+        profile.machine != machineId()) {
+      qInfo("Calibrating %s", machineId().c_str());
+      profile = calibrate(settings, [](const std::string &line) {
+        qInfo("  %s", line.c_str());
+      });
+      if (!saveTuning(tuningFile, profile, &error)) {
+        qWarning("%s", error.c_str());
+      }
+    }
+    if (!parser.isSet(threads) && !parser.isSet(cpus)) {
+      settings.workers = profile.workers;
+    }
+    if (!applyTuning(profile, !parser.isSet(isa))) {
+      qWarning("%s: this CPU can not run some kernels", tuningFile.c_str());
+    }
+  }
+  auto &scheduler = RenderScheduler::instance();
+  if (!scheduler.configure(settings)) {
+    qWarning("Some scheduler settings could not be applied");
+  }
+  scheduler.setReservedWorkers(RenderPriority::Export,
+                               parser.value(exportWorkers).toInt());
+
   MainWindow w;
   w.showMaximized();
-  return a.exec();
+  const int status = a.exec();
+  if (tracer.enabled() && !tracer.stop()) {
+    qWarning("Can not write the trace file %s",
+             qPrintable(parser.value(trace)));
+  }
+  return status;
 }
@@ -1,10 +1,14 @@
 #include "mainwindow.h"
 
 #include <QDebug>
+#include <QFileInfo>
+#include <QProgressBar>
+#include <QToolButton>
 
 #include "./ui_mainwindow.h"
 #include "display_widget.h"
 #include "exportdialog.h"
+#include "exportjob.h"
 
 template <typename Type>
 double GetNumber(Type *l) {
@@ -49,18 +53,7 @@ void MainWindow::SetUp() {
   connect(ui->comboBoxOrbitType, &QComboBox::activated, this,
           &MainWindow::UpdateAllParametersAndRender);
 
-  name2gp["gpGrayscale"] = ColorMapper::gpGrayscale;
-  name2gp["gpHot"] = ColorMapper::gpHot;
-  name2gp["gpCold"] = ColorMapper::gpCold;
-  name2gp["gpNight"] = ColorMapper::gpNight;
-  name2gp["gpCandy"] = ColorMapper::gpCandy;
-  name2gp["gpGeography"] = ColorMapper::gpGeography;
-  name2gp["gpIon"] = ColorMapper::gpIon;
-  name2gp["gpThermal"] = ColorMapper::gpThermal;
-  name2gp["gpPolar"] = ColorMapper::gpPolar;
-  name2gp["gpSpectrum"] = ColorMapper::gpSpectrum;
-  name2gp["gpJet"] = ColorMapper::gpJet;
-  name2gp["gpHues"] = ColorMapper::gpHues;
+  name2gp = ColorMapper::presetNames();
   UpdateAllParameters();
   on_checkBoxLogScale_clicked(ui->checkBoxLogScale->isChecked());
   on_comboBoxCmaps_currentTextChanged(ui->comboBoxCmaps->currentText());
@@ -135,9 +128,41 @@ void MainWindow::on_pBSaveRawData_clicked() {
   dlg.setColorMapParameters(displayWidget->colorMap(),
                             displayWidget->useLogScale(),
                             displayWidget->colorOffset());
+  if (!displayWidget->imgData.data.empty()) {
+    dlg.setValueRange(displayWidget->imgData.minVal,
+                      displayWidget->imgData.maxVal);
+  }
 
   dlg.setBBoxSize(displayWidget->size());
-  dlg.exec();
+  if (dlg.exec() != QDialog::Accepted || !dlg.exportJob()) return;
+
+  // The export runs in background, the progress and a cancel button stay in
+  // the status bar until it is done.
+  auto *job = new ExportJob(dlg.exportName(), dlg.exportJob(), this);
+  auto *bar = new QProgressBar(ui->statusbar);
+  bar->setFormat(QFileInfo(job->name()).fileName() + " %p%");
+  bar->setRange(0, 0);
+  auto *cancel = new QToolButton(ui->statusbar);
+  cancel->setText("Cancel");
+  ui->statusbar->addPermanentWidget(bar);
+  ui->statusbar->addPermanentWidget(cancel);
+  connect(cancel, &QToolButton::clicked, job, &ExportJob::cancel);
+  connect(job, &ExportJob::progress, bar, [bar](int done, int total) {
+    bar->setRange(0, total);
+    bar->setValue(done);
+  });
+  connect(job, &ExportJob::done, this, [this, job, bar, cancel](bool ok) {
+    ui->statusbar->showMessage(
+        QString("Export of %1 %2")
+            .arg(job->name(), job->isCancelled() ? "cancelled"
+                              : ok               ? "done"
+                                                 : "failed"),
+        5000);
+    bar->deleteLater();
+    cancel->deleteLater();
+  });
+  connect(job, &QThread::finished, job, &QObject::deleteLater);
+  job->start();
 }
 
 void MainWindow::on_horizontalSlider_valueChanged(int value) {
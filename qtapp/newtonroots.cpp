@@ -0,0 +1,164 @@
+#include "newtonroots.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+using cmplx = std::complex<double>;
+
+constexpr double kPi = 3.14159265358979323846;
+
+cmplx f(int n, cmplx q, cmplx c, cmplx z) {
+  return std::pow(z, n) + q * z + c;
+}
+
+cmplx df(int n, cmplx q, cmplx z) {
+  return static_cast<double>(n) * std::pow(z, n - 1) + q;
+}
+
+// Bound of |f''| on the disc of radius r around z: f'' = n (n - 1) z^(n - 2).
+double maxD2(int n, cmplx z, double r) {
+  return n * (n - 1.0) * std::pow(std::abs(z) + r, n - 2);
+}
+
+// Durand-Kerner: all the roots at once from points on a spiral.
+std::vector<cmplx> findRoots(int n, cmplx q, cmplx c) {
+  const double scale =
+      1.0 + std::max(std::pow(std::abs(c), 1.0 / n), std::abs(q));
+  std::vector<cmplx> z(n);
+  for (int j = 0; j < n; ++j) z[j] = scale * std::pow(cmplx(0.4, 0.9), j);
+  for (int it = 0; it < 500; ++it) {
+    double change = 0.0;
+    for (int j = 0; j < n; ++j) {
+      cmplx den = 1.0;
+      for (int k = 0; k < n; ++k) {
+        if (k != j) den *= z[j] - z[k];
+      }
+      if (den == 0.0) continue;
+      const cmplx delta = f(n, q, c, z[j]) / den;
+      z[j] -= delta;
+      change = std::max(change, std::abs(delta));
+    }
+    if (change <= 1e-15 * scale) break;
+  }
+  // Polished with Newton's method on each root.
+  for (cmplx &root : z) {
+    for (int it = 0; it < 4; ++it) {
+      const cmplx d = df(n, q, root);
+      if (d == 0.0) break;
+      root -= f(n, q, c, root) / d;
+    }
+  }
+  return z;
+}
+
+}  // namespace
+
+void NewtonRoots::Init(int n, std::complex<double> q, std::complex<double> c,
+                       double eps) {
+  roots_.clear();
+  eps_ = eps;
+  gate_ = 0.0;
+  if (n < 2 || (q == 0.0 && c == 0.0)) return;
+
+  std::vector<cmplx> z;
+  if (q == 0.0) {
+    // z^n = -c.
+    const double r = std::pow(std::abs(c), 1.0 / n);
+    const double theta = std::arg(-c) / n;
+    for (int j = 0; j < n; ++j) {
+      z.push_back(std::polar(r, theta + 2 * kPi * j / n));
+    }
+  } else {
+    z = findRoots(n, q, c);
+  }
+
+  for (int j = 0; j < n; ++j) {
+    double gap = std::numeric_limits<double>::max();
+    for (int k = 0; k < n; ++k) {
+      if (k != j) gap = std::min(gap, std::abs(z[j] - z[k]));
+    }
+    const double d1 = std::abs(df(n, q, z[j]));
+    if (!(d1 > 0.0) || !std::isfinite(d1)) {
+      roots_.clear();
+      return;
+    }
+    // A polynomial of degree n has a root within n |f / f'| of any point:
+    // f'/f = sum 1 / (z - root), so one of the terms is at least |f'/f| / n.
+    //
+    // The second term bounds how far the Newton step of the families,
+    // computed in doubles, lands from the exact one, to first order. A step
+    // rounds fewer than 10 + 5n operations (the power z^(n-1), f' and the
+    // quotient), each within u = 2^-53 of the sum of the magnitudes it
+    // combines. In the power these sums reach 2^(n-1) |z|^(n-1), the sum of
+    // the binomial coefficients, e.g. 15 x^4 y^2 + ... for n = 7, and the
+    // quotient by f' and |f'|^2 triples a relative error of f'. Relative to
+    // the terms of the step, |z| and (|z^n| + |Qz| + |C|) / |f'|, or 1 near
+    // 0, that is at most 3 (10 + 5n) 2^(n-1) u, with 4 instead of 3 for the
+    // second order. For n > 7 std::pow() computes exp((n - 1) log z), within
+    // about n |log |z|| ulps, also below it. Up to large powers the term
+    // stays far below the eps of the families, so it costs no shortcut;
+    // beyond, the disc check below drops the roots. fractalgen-accuracy
+    // compares the early exit to the plain iteration of
+    // Fractal::Create(p, false).
+    const double rho = std::abs(z[j]);
+    const double rounding = 4.0 * (10 + 5 * n) * std::ldexp(1.0, n - 1) *
+                            std::numeric_limits<double>::epsilon() / 2;
+    const double error =
+        n * std::abs(f(n, q, c, z[j])) / d1 +
+        rounding * (1.0 + rho +
+                    (std::pow(rho, n) + std::abs(q) * rho + std::abs(c)) / d1);
+    // The disc holds one root and f' stays at least half of f'(root) in it.
+    double radius = gap / 4;
+    while (radius > 0.0 && 2 * maxD2(n, z[j], radius + error) *
+                                   (radius + error) > d1) {
+      radius /= 2;
+    }
+    if (!(error < radius / 4)) {
+      roots_.clear();
+      return;
+    }
+    // N(z) - root = (f'(z) (z - root) - f(z)) / f'(z), the numerator being at
+    // most 3/2 max|f''| |z - root|^2.
+    const double m2 = maxD2(n, z[j], radius + error);
+    const double k = 1.5 * m2 / (d1 - m2 * (radius + error));
+    // Two more steps are only certain while K d^2 < eps, and an iterate gets
+    // there from about sqrt(reach / K) in one step.
+    const double reach = std::min(radius, 2 * std::sqrt(eps / k));
+    roots_.push_back({z[j], radius, reach, k, error});
+    gate_ = std::max(gate_, std::sqrt(reach / k) + reach);
+  }
+}
+
+int NewtonRoots::RemainingSteps(double x, double y) const {
+  const Root *r = nullptr;
+  double dist2 = 0.0;
+  for (const Root &root : roots_) {
+    const double dx = x - root.z.real();
+    const double dy = y - root.z.imag();
+    dist2 = dx * dx + dy * dy;
+    if (dist2 <= root.reach * root.reach) {
+      r = &root;
+      break;
+    }
+  }
+  if (!r) return 0;
+  const double eps = eps_;
+  // Distance to the exact root, and how far the next iterate may be from it.
+  const double d = std::sqrt(dist2) + r->error;
+  if (d + r->error > r->radius) return 0;
+  const double d1 = r->k * d * d + r->error;
+  // The next step is the way to the root, give or take d1 and the error of
+  // the root, per coordinate.
+  const double to_root = std::max(std::abs(r->z.real() - x),
+                                  std::abs(r->z.imag() - y));
+  const double slack = d1 + r->error;
+  if (to_root + slack < eps) return 1;
+  if (to_root - slack < eps || d1 + r->error > r->radius) return 0;
+  // The step after that is at most the way from the next iterate to the
+  // root and from the root to the one after.
+  const double d2 = r->k * d1 * d1 + r->error;
+  return d1 + d2 < eps ? 2 : 0;
+}
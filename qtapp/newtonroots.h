@@ -0,0 +1,42 @@
+#ifndef NEWTONROOTS_H
+#define NEWTONROOTS_H
+#include <complex>
+#include <vector>
+
+// The roots of f(z) = z^n + Qz + C, the attractors of the Newton families,
+// and around each a disc where Newton's method is certain to converge
+// quadratically: |N(z) - root| <= K |z - root|^2. Family03 and Family04 use it
+// to stop iterating once the count at which the step falls below eps is known
+// for sure, which gives the same count as iterating.
+class NewtonRoots {
+ public:
+  // Roots of z^n + c analytically when q is 0, else numerically. Without a
+  // simple root (n < 2, or a multiple root) it stays empty. eps is the step
+  // at which the families stop.
+  void Init(int n, std::complex<double> q, std::complex<double> c,
+            double eps);
+  bool empty() const { return roots_.empty(); }
+
+  // Newton iterates from (x, y) that the escape time loop of the families
+  // still runs, the last one being the first whose step max(|dx|, |dy|) is
+  // below eps: 1 or 2, or 0 when it is not certain.
+  int RemainingSteps(double x, double y) const;
+
+  // After a step above this the iterate is too far from the roots for
+  // RemainingSteps(), no need to call it.
+  double gate() const { return gate_; }
+
+ private:
+  struct Root {
+    std::complex<double> z;
+    double radius;  // of the disc
+    double reach;   // distance up to which RemainingSteps() may succeed
+    double k;       // quadratic convergence constant in the disc
+    double error;   // bound of |z - exact root|, plus rounding of an iterate
+  };
+  std::vector<Root> roots_;
+  double eps_ = 0.0;
+  double gate_ = 0.0;
+};
+
+#endif  // NEWTONROOTS_H
@@ -0,0 +1,122 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef __linux__
+struct EventType {
+  uint32_t type;
+  uint64_t config;
+};
+
+const EventType kEvents[PerfCounters::kCounters] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+// User space only, which perf_event_paranoid 2, the usual default, allows.
+int openCounter(const EventType &event, pid_t tid) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+std::vector<pid_t> processThreads() {
+  std::vector<pid_t> tids;
+  DIR *dir = opendir("/proc/self/task");
+  if (!dir) return tids;
+  while (const dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') tids.push_back(std::atoi(entry->d_name));
+  }
+  closedir(dir);
+  return tids;
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  for (const pid_t tid : processThreads()) {
+    for (int c = 0; c < kCounters; ++c) {
+      const int fd = openCounter(kEvents[c], tid);
+      if (fd >= 0) fds_[c].push_back(fd);
+    }
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const auto &fds : fds_) {
+    for (const int fd : fds) close(fd);
+  }
+#endif
+}
+
+bool PerfCounters::available() const {
+  for (const auto &fds : fds_) {
+    if (!fds.empty()) return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (const auto &fds : fds_) {
+    for (const int fd : fds) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (const auto &fds : fds_) {
+    for (const int fd : fds) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+#endif
+}
+
+PerfCounters::Values PerfCounters::read() const {
+  Values values;
+  values.fill(-1.0);
+#ifdef __linux__
+  for (int c = 0; c < kCounters; ++c) {
+    if (fds_[c].empty()) continue;
+    values[c] = 0.0;
+    for (const int fd : fds_[c]) {
+      uint64_t data[3];  // value, time enabled, time running
+      if (::read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+        continue;
+      }
+      values[c] += static_cast<double>(data[0]) * data[1] / data[2];
+    }
+  }
+#endif
+  return values;
+}
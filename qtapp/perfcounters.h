@@ -0,0 +1,39 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+#include <array>
+#include <vector>
+
+// Hardware counters of the whole process through Linux perf_event_open(),
+// summed over its threads. Only counts the threads running when it is
+// created, so the render workers must be started first. Counters the kernel
+// or the CPU do not provide read as -1, as all do on other systems.
+class PerfCounters {
+ public:
+  enum Counter {
+    kCycles,
+    kInstructions,
+    kBranchMisses,
+    kCacheMisses,
+    kCounters
+  };
+  using Values = std::array<double, kCounters>;
+
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // True when at least one counter could be opened.
+  bool available() const;
+  // Zeroes the counters and starts counting.
+  void start();
+  void stop();
+  // The counts since start(), scaled up when the kernel had to multiplex
+  // the counters.
+  Values read() const;
+
+ private:
+  std::array<std::vector<int>, kCounters> fds_;  // one per thread
+};
+
+#endif  // PERFCOUNTERS_H
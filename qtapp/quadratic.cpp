@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <limits>
+
+#include "fractals.h"
+#include "kernels.h"
+
+void Quadratic::Init(const FractalParameters &p) {
+  Fractal::Init(p);
+  c_.real(p.c.real());
+  c_.imag(p.c.imag());
+  family_ = p.fractal_family;
+  if (family_ == 0) {
+    z0_ = 0;
+    it0_ = 0;
+  } else {
+    z0_ = c_;
+    it0_ = 1;
+  }
+}
+
+double Quadratic::CalcFinalNormMandelbrot(const cmplx &c) const {
+  int iter = 1;
+  dbltype x = c_.real();
+  dbltype y = c_.imag();
+  dbltype dist = std::numeric_limits<double>::max();
+  for (; iter < max_iter_; ++iter) {
+    dist = std::min(orbit_metric_funct_(x, y), dist);
+    const dbltype x2 = x * x;
+    const dbltype y2 = y * y;
+    if (x2 + y2 >= th_norm_) break;
+    y *= 2 * x;
+    x = x2 - y2 + c.real();
+    y += c.imag();
+  }
+  return dist;
+}
+
+double Quadratic::CalcFinalNormJulia(const cmplx &z) const {
+  int iter = 0;
+  dbltype x = z.real();
+  dbltype y = z.imag();
+  dbltype dist = std::numeric_limits<dbltype>::max();
+  for (; iter < max_iter_; ++iter) {
+    dist = std::min(orbit_metric_funct_(x, y), dist);
+    const dbltype x2 = x * x;
+    const dbltype y2 = y * y;
+    if (x2 + y2 >= th_norm_) break;
+    y *= 2 * x;
+    x = x2 - y2 + c_.real();
+    y += c_.imag();
+  }
+  return dist;
+}
+
+//////////////////////////////////////////
+double Quadratic::CalcEscapeJulia(const cmplx &z) const {
+  int iter = 0;
+  dbltype x = z.real();
+  dbltype y = z.imag();
+  for (;;) {
+    const dbltype x2 = x * x;
+    const dbltype y2 = y * y;
+    if (x2 + y2 >= th_norm_ || iter >= max_iter_) break;
+    y *= 2 * x;
+    x = x2 - y2 + c_.real();
+    y += c_.imag();
+    ++iter;
+  }
+  return iter;
+}
+
+double Quadratic::CalcEscapeMandelbrot(const cmplx &c) const {
+  int iter = it0_;
+  dbltype x = z0_.real();
+  dbltype y = z0_.imag();
+  for (;;) {
+    const dbltype x2 = x * x;
+    const dbltype y2 = y * y;
+    if (x2 + y2 >= th_norm_ || iter >= max_iter_) break;
+    y *= 2 * x;
+    x = x2 - y2 + c.real();
+    y += c.imag();
+    ++iter;
+  }
+  return iter;
+}
+
+void Quadratic::EvaluateSpan(bool mandelbrot, int orbit_trap, dbltype x0,
+                             dbltype dx, int k0, int n, dbltype y,
+                             double *out) const {
+  if (orbit_trap != 0) {
+    Fractal::EvaluateSpan(mandelbrot, orbit_trap, x0, dx, k0, n, y, out);
+    return;
+  }
+  EscapeParams p;
+  p.mandelbrot = mandelbrot;
+  p.c_re = c_.real();
+  p.c_im = c_.imag();
+  p.z0_re = z0_.real();
+  p.z0_im = z0_.imag();
+  p.it0 = it0_;
+  p.n = 2;
+  p.th_norm = th_norm_;
+  p.max_iter = max_iter_;
+  kernels(familyIsa(family_)).escape02(p, x0, dx, k0, n, y, out);
+}
@@ -0,0 +1,111 @@
+#include "relief.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "renderscheduler.h"
+
+namespace {
+
+// A non-finite intensity leaves the color as it is, like 0.5.
+inline uint32_t overlay(uint32_t c, double intensity) {
+  if (!std::isfinite(intensity)) return c;
+  intensity = std::clamp(intensity, 0.0, 1.0);
+  uint32_t out = c & 0xff000000u;
+  for (int shift = 0; shift <= 16; shift += 8) {
+    const double v = ((c >> shift) & 0xff) / 255.0;
+    const double b = v <= 0.5 ? 2.0 * intensity * v
+                              : 1.0 - 2.0 * (1.0 - intensity) * (1.0 - v);
+    out |= static_cast<uint32_t>(b * 255.0 + 0.5) << shift;
+  }
+  return out;
+}
+
+struct Light {
+  double x, y, z;  // unit vector towards the light
+  double scale;    // of the slopes
+};
+
+Light lightOf(const ReliefSettings &light, double zscale) {
+  constexpr double kDeg = M_PI / 180.0;
+  const double az = (90.0 - light.azimuth) * kDeg;
+  const double alt = light.altitude * kDeg;
+  return {std::cos(az) * std::cos(alt), std::sin(az) * std::cos(alt),
+          std::sin(alt), zscale * light.exaggeration};
+}
+
+// Hillshade intensity of row i of the field into out[0, W).
+void intensityRow(const double *z, int z_row0, int z_rows, int W, int i,
+                  const Light &light, double *out) {
+  // Central differences, one sided on the borders of the field. The first
+  // row is the top of the image, so y grows upwards as -i.
+  const int up = std::max(i - 1, z_row0);
+  const int down = std::min(i + 1, z_row0 + z_rows - 1);
+  const double *zu = z + static_cast<size_t>(up - z_row0) * W;
+  const double *zd = z + static_cast<size_t>(down - z_row0) * W;
+  const double *zc = z + static_cast<size_t>(i - z_row0) * W;
+  const double scale = light.scale;
+  const double ry = down > up ? scale / (down - up) : 0.0;
+  for (int k = 0; k < W; ++k) {
+    const int l = std::max(k - 1, 0);
+    const int r = std::min(k + 1, W - 1);
+    const double dzdx = r > l ? (zc[r] - zc[l]) * scale / (r - l) : 0.0;
+    const double dzdy = -(zd[k] - zu[k]) * ry;
+    // normal = (-dz/dx, -dz/dy, 1) / |.|, flat where the slopes are not
+    // finite.
+    double intensity = (-dzdx * light.x - dzdy * light.y + light.z) /
+                       std::sqrt(dzdx * dzdx + dzdy * dzdy + 1.0);
+    if (!std::isfinite(intensity)) intensity = light.z;
+    out[k] = intensity;
+  }
+}
+
+}  // namespace
+
+std::pair<double, double> reliefRange(const double *z, int z_row0, int z_rows,
+                                      int W, int row0, int rows,
+                                      double zscale,
+                                      const ReliefSettings &light) {
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  const Light l = lightOf(light, zscale);
+  std::vector<std::pair<double, double>> bounds(rows, {kInf, -kInf});
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, row0, row0 + rows, [&](int i) {
+        thread_local std::vector<double> intensity;
+        intensity.resize(W);
+        intensityRow(z, z_row0, z_rows, W, i, l, intensity.data());
+        auto &b = bounds[i - row0];
+        for (const double v : intensity) {
+          b = {std::min(b.first, v), std::max(b.second, v)};
+        }
+      });
+  std::pair<double, double> range = {kInf, -kInf};
+  for (const auto &b : bounds) {
+    range = {std::min(range.first, b.first), std::max(range.second, b.second)};
+  }
+  return range;
+}
+
+void shadeRelief(const double *z, int z_row0, int z_rows, int W, int row0,
+                 int rows, double zscale, const ReliefSettings &light,
+                 std::pair<double, double> range, uint32_t *image) {
+  const Light l = lightOf(light, zscale);
+  // Like matplotlib, a flat image is not stretched.
+  const double span = range.second - range.first;
+  const bool stretch = span > 1e-6;
+
+  RenderScheduler::instance().parallelFor(
+      RenderPriority::Export, row0, row0 + rows, [&](int i) {
+        thread_local std::vector<double> intensity;
+        intensity.resize(W);
+        intensityRow(z, z_row0, z_rows, W, i, l, intensity.data());
+        uint32_t *line = image + static_cast<size_t>(i - row0) * W;
+        for (int k = 0; k < W; ++k) {
+          const double v = stretch ? (intensity[k] - range.first) / span
+                                   : intensity[k];
+          line[k] = overlay(line[k], v);
+        }
+      });
+}
@@ -0,0 +1,30 @@
+#ifndef RELIEF_H
+#define RELIEF_H
+#include <cstdint>
+#include <utility>
+
+struct ReliefSettings {
+  double azimuth = 315.0;  // degrees, clockwise from north
+  double altitude = 45.0;  // degrees above the horizon
+  double exaggeration = 1.0;
+};
+
+// Smallest and largest finite hillshade intensity of the rows
+// [row0, row0 + rows) of the field, same arguments as shadeRelief().
+std::pair<double, double> reliefRange(const double *z, int z_row0, int z_rows,
+                                      int W, int row0, int rows,
+                                      double zscale,
+                                      const ReliefSettings &light);
+
+// Overlay-blends the hillshade of a height field into a colored image, like
+// matplotlib's LightSource.shade(blend_mode="overlay") used by plot.py. As
+// there, the intensity is stretched from `range`, the reliefRange() of the
+// whole image, to [0, 1] before blending; strip by strip the caller has to
+// estimate it. `z` holds the rows [z_row0, z_row0 + z_rows) of the field, W
+// values each, and `image` the rows [row0, row0 + rows) which must be inside
+// them. Slopes are taken per pixel and multiplied by `zscale`.
+void shadeRelief(const double *z, int z_row0, int z_rows, int W, int row0,
+                 int rows, double zscale, const ReliefSettings &light,
+                 std::pair<double, double> range, uint32_t *image);
+
+#endif  // RELIEF_H
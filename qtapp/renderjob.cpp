@@ -0,0 +1,172 @@
+#include "renderjob.h"
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+
+namespace {
+
+std::string trim(const std::string &s) {
+  const size_t first = s.find_first_not_of(" \t\r");
+  if (first == std::string::npos) return {};
+  return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+template <typename T>
+bool read(std::istream &in, T *value) {
+  return static_cast<bool>(in >> *value);
+}
+
+bool read(std::istream &in, bool *value) {
+  std::string word;
+  in >> word;
+  if (word == "true" || word == "1" || word == "yes") {
+    *value = true;
+  } else if (word == "false" || word == "0" || word == "no") {
+    *value = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The rest of the line, so paths may have spaces.
+bool read(std::istream &in, std::string *value) {
+  std::getline(in, *value);
+  *value = trim(*value);
+  return !value->empty();
+}
+
+bool read(std::istream &in, std::complex<double> *value) {
+  double re, im;
+  if (!(in >> re >> im)) return false;
+  *value = {re, im};
+  return true;
+}
+
+using Field = std::function<bool(std::istream &)>;
+
+template <typename T>
+Field field(T *value) {
+  return [value](std::istream &in) { return read(in, value); };
+}
+
+// A value that must also satisfy `valid`.
+template <typename T, typename Valid>
+Field field(T *value, Valid valid) {
+  return [value, valid](std::istream &in) {
+    return read(in, value) && valid(*value);
+  };
+}
+
+}  // namespace
+
+FractalParameters startupParameters() {
+  FractalParameters p{};
+  p.n = 2;
+  p.max_iterations = 500;
+  p.max_norm = 2.0;
+  p.c = {-0.74797, -0.0725};
+  p.q = {0, 0};
+  p.orbit_pt = {1.02, 0.78};
+  p.mandelbrot = false;
+  p.orbit_trap = false;
+  p.orbit_mode = 8;
+  p.fractal_family = 1;
+  return p;
+}
+
+ExportSettings startupSettings() {
+  ExportSettings s{};
+  s.W = 1920;
+  s.H = 1080;
+  s.x0 = -2.0;
+  s.x1 = 1.0;
+  s.y0 = -0.84375;
+  s.y1 = 0.84375;
+  return s;
+}
+
+bool loadRenderJob(const std::string &fname, RenderJob *job,
+                   std::string *error) {
+  std::ifstream ifile(fname);
+  if (!ifile) {
+    *error = "can not open " + fname;
+    return false;
+  }
+
+  FractalParameters &p = job->params;
+  ExportSettings &s = job->settings;
+  const std::map<std::string, Field> keys = {
+      // The families of Fractal::Create().
+      {"family",
+       field(&p.fractal_family, [](int f) { return f >= 0 && f <= 4; })},
+      {"c", field(&p.c)},
+      {"q", field(&p.q)},
+      {"n", field(&p.n, [](int n) { return n >= 2; })},
+      {"max_iterations",
+       field(&p.max_iterations, [](int n) { return n >= 1; })},
+      {"max_norm", field(&p.max_norm)},
+      {"mandelbrot", field(&p.mandelbrot)},
+      {"orbit_trap", field(&p.orbit_trap)},
+      // The orbit metrics of Fractal::GetOrbitMetric().
+      {"orbit_mode",
+       field(&p.orbit_mode, [](int m) { return m >= 0 && m <= 14; })},
+      {"orbit_pt", field(&p.orbit_pt)},
+      {"bbox",
+       [&](std::istream &in) {
+         return static_cast<bool>(in >> s.x0 >> s.x1 >> s.y0 >> s.y1) &&
+                s.x0 < s.x1 && s.y0 < s.y1;
+       }},
+      {"size",
+       [&](std::istream &in) { return static_cast<bool>(in >> s.W >> s.H); }},
+      {"ssaa", field(&s.ssaa, [](int n) { return n >= 0; })},
+      {"smooth_radius",
+       field(&s.smooth_radius, [](int r) { return r >= 0; })},
+      {"relief", field(&s.relief)},
+      {"relief_exaggeration", field(&s.light.exaggeration)},
+      {"colormap", field(&job->colormap)},
+      {"log", field(&job->log)},
+      {"offset", field(&job->offset)},
+      {"periodic", field(&job->periodic)},
+      {"range",
+       [&](std::istream &in) {
+         double lower, upper;
+         if (!(in >> lower >> upper)) return false;
+         job->range = std::make_pair(lower, upper);
+         return true;
+       }},
+      {"output", field(&job->output)},
+  };
+
+  std::string line;
+  for (int number = 1; std::getline(ifile, line); ++number) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+    const std::string where = fname + ":" + std::to_string(number) + ": ";
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      *error = where + "expected key = value";
+      return false;
+    }
+    const std::string key = trim(line.substr(0, eq));
+    const auto it = keys.find(key);
+    if (it == keys.end()) {
+      *error = where + "unknown key " + key;
+      return false;
+    }
+    std::istringstream in(line.substr(eq + 1));
+    std::string rest;
+    if (!it->second(in) || in >> rest) {
+      *error = where + "bad value for " + key;
+      return false;
+    }
+  }
+
+  if (s.W < 1 || s.H < 1) {
+    *error = fname + ": the size must be positive";
+    return false;
+  }
+  return true;
+}
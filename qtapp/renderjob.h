@@ -0,0 +1,44 @@
+#ifndef RENDERJOB_H
+#define RENDERJOB_H
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "exporter.h"
+#include "fractals.h"
+
+// The startup values of the application.
+FractalParameters startupParameters();
+ExportSettings startupSettings();
+
+// Everything needed to render an image without the application: the fractal,
+// the area and size, the coloring and the output file.
+struct RenderJob {
+  FractalParameters params = startupParameters();
+  ExportSettings settings = startupSettings();
+  std::string colormap = "gpGrayscale";
+  bool log = false;
+  double offset = 0.0;
+  bool periodic = true;  // like the colormaps of the application
+  std::optional<std::pair<double, double>> range;  // estimated when empty
+  std::string output;  // .raw for the data, else any StripImageWriter format
+};
+
+// Reads a parameter file of "key = value" lines, '#' starting a comment.
+// Complex numbers and boxes are given as space separated numbers:
+//
+//   family = 1
+//   c = -0.74797 -0.0725
+//   bbox = -2 1 -1.2 1.2      # x0 x1 y0 y1
+//   size = 7680 4320
+//   colormap = gpHot
+//
+// Keys not in the file keep the defaults of the application. Returns false
+// with a message in `error` on unknown keys or bad values, which include
+// values out of range: a family other than 0 to 4, n < 2, max_iterations < 1,
+// an orbit_mode other than 0 to 14, a negative ssaa or smooth_radius and an
+// empty bbox.
+bool loadRenderJob(const std::string &fname, RenderJob *job,
+                   std::string *error);
+
+#endif  // RENDERJOB_H
@@ -0,0 +1,285 @@
+#include "renderscheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+#include "trace.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+thread_local bool is_worker = false;
+
+// The CPUs the process may run on.
+std::vector<int> processCpus() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    cpus.resize(std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t cpu = 0; cpu < cpus.size(); ++cpu) cpus[cpu] = cpu;
+  }
+  return cpus;
+}
+
+}  // namespace
+
+std::vector<int> parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::istringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    const size_t dash = range.find('-');
+    try {
+      const int first = std::stoi(range.substr(0, dash));
+      const int last =
+          dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    } catch (const std::exception &) {
+      return {};
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+RenderScheduler &RenderScheduler::instance() {
+  static RenderScheduler scheduler;
+  return scheduler;
+}
+
+RenderScheduler::RenderScheduler(const SchedulerSettings &settings) {
+  start(settings);
+}
+
+RenderScheduler::~RenderScheduler() { stop(); }
+
+bool RenderScheduler::configure(const SchedulerSettings &settings) {
+  stop();
+  return start(settings);
+}
+
+bool RenderScheduler::start(const SchedulerSettings &settings) {
+  bool ok = true;
+  const std::vector<int> allowed = processCpus();
+  std::vector<int> cpus;
+  for (int cpu : settings.cpus) {
+    if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+      cpus.push_back(cpu);
+    } else {
+      ok = false;
+    }
+  }
+  const bool pinned = !cpus.empty();
+  if (!pinned) cpus = allowed;
+  const int workers =
+      settings.workers > 0 ? settings.workers : static_cast<int>(cpus.size());
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  worker_cpus_.assign(workers, {});
+  worker_partition_.assign(workers, 0);
+  partition_workers_.assign(1, workers);
+  partition_node_.assign(1, -1);
+
+  if (settings.numa) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+      // CPUs sorted by node, worker i takes the node of the CPU at the same
+      // relative position, so partitions are proportional to the CPUs.
+      std::vector<std::pair<int, int>> node_cpus;
+      for (int cpu : cpus) node_cpus.emplace_back(numa_node_of_cpu(cpu), cpu);
+      std::sort(node_cpus.begin(), node_cpus.end());
+      partition_workers_.clear();
+      partition_node_.clear();
+      for (int w = 0; w < workers; ++w) {
+        const int node = node_cpus[w * node_cpus.size() / workers].first;
+        if (partition_node_.empty() || partition_node_.back() != node) {
+          partition_node_.push_back(node);
+          partition_workers_.push_back(0);
+        }
+        ++partition_workers_.back();
+        worker_partition_[w] = static_cast<int>(partition_node_.size()) - 1;
+        for (const auto &[n, cpu] : node_cpus) {
+          if (n == node) worker_cpus_[w].push_back(cpu);
+        }
+      }
+    } else {
+      ok = false;
+    }
+#else
+    ok = false;
+#endif
+  }
+  if (pinned && partition_node_[0] < 0) {
+    for (int w = 0; w < workers; ++w) worker_cpus_[w] = {cpus[w % cpus.size()]};
+  }
+  lock.unlock();
+
+  for (int w = 0; w < workers; ++w) {
+    workers_.emplace_back(&RenderScheduler::workerLoop, this, w);
+  }
+  return ok;
+}
+
+void RenderScheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  for (auto &worker : workers_) worker.join();
+  workers_.clear();
+  stop_ = false;
+}
+
+std::vector<int> RenderScheduler::partitionBounds(int begin, int end) const {
+  int workers = 0;
+  for (int count : partition_workers_) workers += count;
+  std::vector<int> bounds{begin};
+  int64_t sum = 0;
+  for (int count : partition_workers_) {
+    sum += count;
+    bounds.push_back(begin + static_cast<int>((end - begin) * sum / workers));
+  }
+  bounds.back() = end;
+  return bounds;
+}
+
+void RenderScheduler::parallelFor(RenderPriority priority, int begin, int end,
+                                  const std::function<void(int)> &body,
+                                  int grain) {
+  if (begin >= end) return;
+  if (is_worker) {
+    for (int i = begin; i < end; ++i) body(i);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  Job job{std::max(grain, 1), end - begin, {}, &body};
+  const std::vector<int> bounds = partitionBounds(begin, end);
+  for (size_t p = 0; p + 1 < bounds.size(); ++p) {
+    job.parts.emplace_back(bounds[p], bounds[p + 1]);
+  }
+  queues_[static_cast<int>(priority)].push_back(&job);
+  work_.notify_all();
+  done_.wait(lock, [&job] { return job.pending == 0; });
+}
+
+void RenderScheduler::bindRows(void *data, size_t row_bytes, int begin,
+                               int end) {
+#ifdef HAVE_LIBNUMA
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (partition_node_[0] < 0 || begin >= end) return;
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  const uintptr_t base = reinterpret_cast<uintptr_t>(data);
+  const std::vector<int> bounds = partitionBounds(begin, end);
+  for (size_t p = 0; p < partition_node_.size(); ++p) {
+    // Pages shared by two partitions go to the first one.
+    uintptr_t first = base + (bounds[p] - begin) * row_bytes;
+    uintptr_t last = base + (bounds[p + 1] - begin) * row_bytes;
+    first = p == 0 ? first & ~(page - 1) : (first + page - 1) & ~(page - 1);
+    last = (last + page - 1) & ~(page - 1);
+    if (last <= first) continue;
+    const int node = partition_node_[p];
+    const int bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(node / bits + 1);
+    mask[node / bits] |= 1UL << (node % bits);
+    mbind(reinterpret_cast<void *>(first), last - first, MPOL_PREFERRED,
+          mask.data(), mask.size() * bits, 0);
+  }
+#endif
+}
+
+void RenderScheduler::setReservedWorkers(RenderPriority priority, int count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reserved_[static_cast<int>(priority)] = std::max(count, 0);
+}
+
+RenderScheduler::Job *RenderScheduler::pick(int worker) {
+  // Reserved workers are numbered from 0 in priority order.
+  int preferred = -1;
+  for (int p = 0, first = 0; p < kPriorities; first += reserved_[p++]) {
+    if (worker >= first && worker < first + reserved_[p]) preferred = p;
+  }
+  if (preferred >= 0 && !queues_[preferred].empty()) {
+    return queues_[preferred].front();
+  }
+  for (auto &queue : queues_) {
+    if (!queue.empty()) return queue.front();
+  }
+  return nullptr;
+}
+
+void RenderScheduler::workerLoop(int worker) {
+  is_worker = true;
+  Tracer::instance().setThreadName("worker " + std::to_string(worker));
+#ifdef __linux__
+  if (!worker_cpus_[worker].empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : worker_cpus_[worker]) CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+  const int partition = worker_partition_[worker];
+#ifdef HAVE_LIBNUMA
+  // The thread local buffers of the worker stay on its node too.
+  if (partition_node_[partition] >= 0) {
+    numa_set_preferred(partition_node_[partition]);
+  }
+#endif
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    Job *job = pick(worker);
+    if (!job) {
+      work_.wait(lock);
+      continue;
+    }
+    // The block of the own partition first, else the one with most work
+    // left. Jobs queued before a configure() may have less partitions.
+    auto part = job->parts.begin();
+    if (partition < static_cast<int>(job->parts.size()) &&
+        job->parts[partition].first < job->parts[partition].second) {
+      part += partition;
+    } else {
+      part = std::max_element(
+          job->parts.begin(), job->parts.end(), [](auto &a, auto &b) {
+            return a.second - a.first < b.second - b.first;
+          });
+    }
+    const int i0 = part->first;
+    const int i1 = std::min(i0 + job->grain, part->second);
+    part->first = i1;
+    if (std::all_of(job->parts.begin(), job->parts.end(),
+                    [](auto &p) { return p.first == p.second; })) {
+      for (auto &queue : queues_) {
+        queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+      }
+    }
+    lock.unlock();
+    {
+      TRACE_SCOPE("tile");
+      for (int i = i0; i < i1; ++i) (*job->body)(i);
+    }
+    lock.lock();
+    job->pending -= i1 - i0;
+    if (job->pending == 0) done_.notify_all();
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Lower values preempt higher ones.
+enum class RenderPriority { Interactive = 0, Export = 1 };
+
+struct SchedulerSettings {
+  int workers = 0;        // 0 starts one worker per allowed CPU
+  std::vector<int> cpus;  // allowed CPUs, empty for all of the process
+  bool numa = false;      // one worker partition per NUMA node
+};
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}, the Linux cpulist format.
+std::vector<int> parseCpuList(const std::string &list);
+
+// One pool of workers shared by every render. Jobs are split in tiles of
+// `grain` indices and a free worker always takes the next tile of the highest
+// priority job, so an interactive frame preempts a running export at tile
+// granularity. Each class can reserve workers that take its tiles before any
+// other, which guarantees that class a share of the cores.
+//
+// With explicit CPUs every worker is pinned to one of them. In NUMA mode the
+// workers are split in one partition per node, pinned to the CPUs of their
+// node, and every job is split in contiguous blocks, one per partition, that
+// the partition computes first; bindRows() places the matching rows of a
+// buffer on the same node.
+class RenderScheduler {
+ public:
+  static RenderScheduler &instance();
+
+  explicit RenderScheduler(const SchedulerSettings &settings = {});
+  ~RenderScheduler();
+  RenderScheduler(const RenderScheduler &) = delete;
+  RenderScheduler &operator=(const RenderScheduler &) = delete;
+
+  // Restarts the workers with new settings. Running jobs go on with the new
+  // workers once the tiles in progress are done. Returns false when some
+  // setting could not be applied (unknown CPUs, no NUMA support), the rest
+  // still is. Not to be called from several threads at once.
+  bool configure(const SchedulerSettings &settings);
+
+  // Runs body(i) for every i in [begin, end) and returns once all are done.
+  // The calling thread only waits. Called from a worker, the loop runs
+  // serially on it.
+  void parallelFor(RenderPriority priority, int begin, int end,
+                   const std::function<void(int)> &body, int grain = 1);
+
+  // Binds the pages of the rows [begin, end) of `data`, `row_bytes` each, to
+  // the node of the partition that computes them in parallelFor(begin, end).
+  // Only has an effect in NUMA mode, and on memory not written yet.
+  void bindRows(void *data, size_t row_bytes, int begin, int end);
+
+  // The first `count` workers not reserved by a higher priority class take
+  // the tiles of `priority` first.
+  void setReservedWorkers(RenderPriority priority, int count);
+  int workerCount() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  static constexpr int kPriorities = 2;
+
+  struct Job {
+    int grain;
+    int pending;  // indices not finished yet
+    std::vector<std::pair<int, int>> parts;  // [next, end) per partition
+    const std::function<void(int)> *body;
+  };
+
+  bool start(const SchedulerSettings &settings);
+  void stop();
+  void workerLoop(int worker);
+  Job *pick(int worker);
+  std::vector<int> partitionBounds(int begin, int end) const;
+
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::condition_variable done_;
+  std::deque<Job *> queues_[kPriorities];
+  int reserved_[kPriorities] = {};
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+  std::vector<std::vector<int>> worker_cpus_;  // empty when not pinned
+  std::vector<int> worker_partition_;
+  std::vector<int> partition_workers_;
+  std::vector<int> partition_node_;  // -1 without NUMA
+};
+
+#endif  // RENDERSCHEDULER_H
@@ -3,11 +3,23 @@
 
 #include <QDebug>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <complex>
 #include <numeric>
 #include <vector>
 
+#include "autotune.h"
+#include "renderscheduler.h"
+#include "trace.h"
+
+namespace {
+
+// Side of the tiles the compute time is reported for.
+constexpr int kStatsTile = 32;
+
+}  // namespace
+
 RenderThread::RenderThread(QObject *parent) : QThread(parent) {}
 
 RenderThread::~RenderThread() {
@@ -20,6 +32,7 @@ RenderThread::~RenderThread() {
 }
 
 void RenderThread::render(const FractalParameters &params) {
+  TRACE_SCOPE("handoff");
   QMutexLocker locker(&mutex);
   fractal_parameters_ = params;
 
@@ -32,6 +45,7 @@ void RenderThread::render(const FractalParameters &params) {
 }
 
 void RenderThread::run() {
+  Tracer::instance().setThreadName("render thread");
   forever {
     if (abort) break;
 
@@ -39,40 +53,9 @@ void RenderThread::run() {
     FractalParameters local_params = fractal_parameters_;
     mutex.unlock();
 
-    std::function<float(const cmplx &z)> f;
-    switch (local_params.fractal_family) {
-      case 0:
-        family00.Init(local_params);
-        f = family00.GetCouloringFunction(local_params.mandelbrot,
-                                          local_params.orbit_trap);
-        break;
-      case 1:
-        family01.Init(local_params);
-        f = family01.GetCouloringFunction(local_params.mandelbrot,
-                                          local_params.orbit_trap);
-        break;
-      case 2:
-        family02.Init(local_params);
-        f = family02.GetCouloringFunction(local_params.mandelbrot,
-                                          local_params.orbit_trap);
-        break;
-      case 3:
-        family03.Init(local_params);
-        f = family03.GetCouloringFunction(local_params.mandelbrot,
-                                          local_params.orbit_trap);
-        break;
-      case 4:
-        family04.Init(local_params);
-        f = family04.GetCouloringFunction(local_params.mandelbrot,
-                                          local_params.orbit_trap);
-        break;
-      default:
-        qErrnoWarning(
-            "Wrong fractal family number. Expected [0,1,2,3,4], but get %d",
-            local_params.fractal_family);
-        continue;
-        break;
-    }
+    // The cheapest implementation of the parameters, see Fractal::Create().
+    const std::unique_ptr<Fractal> fractal = Fractal::Create(&local_params);
+    if (!fractal) continue;
 
     //        qDebug() << "Start rendering ...";
     //        qDebug() << "Family     = " << local_params.fractal_family;
@@ -88,31 +71,100 @@ void RenderThread::run() {
     //        qDebug() << "Orbit mode = " << local_params.orbit_mode;
 
     QVector<double> data;
-    const size_t N =
-        local_params.image_size.width() * local_params.image_size.height();
+    const size_t N = static_cast<size_t>(local_params.image_width) *
+                     local_params.image_height;
     const dbltype centerX = local_params.centerX;
     const dbltype centerY = local_params.centerY;
     const dbltype scaleFactor = local_params.scale;
-    const int H = local_params.image_size.height();
-    const int W = local_params.image_size.width();
+    const int H = local_params.image_height;
+    const int W = local_params.image_width;
+    data.reserve(N);
+    RenderScheduler::instance().bindRows(data.data(), sizeof(double) * W, 0, H);
     data.resize(N);
-    if (indexs.size() != H) {
-      indexs.resize(H);
-      std::iota(indexs.begin(), indexs.end(), 0);
+
+    const bool stats = collect_stats_;
+    RenderStats frame;
+    bool escape = false;
+    QVector<double> row_ns;  // per row and tile column, summed per tile below
+    if (stats) {
+      frame.size = QSize(W, H);
+      frame.tile_size = kStatsTile;
+      frame.tiles = QSize((W + kStatsTile - 1) / kStatsTile,
+                          (H + kStatsTile - 1) / kStatsTile);
+      row_ns.resize(H * frame.tiles.width());
+      if (local_params.orbit_trap) {
+        escape = true;
+        frame.iterations.resize(N);
+      }
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const double trace_start = Tracer::instance().now();
+
+    // Interactive frames preempt the exports running at the same time. The
+    // pixels are centerX + k * scaleFactor for k in [-W/2, W/2), the spans
+    // go through the kernel build picked for the family like the exports.
+    const bool mandelbrot = local_params.mandelbrot;
+    const int orbit_trap = local_params.orbit_trap;
+    const int end = W / 2 * 2;
+    RenderScheduler::instance().parallelFor(
+        RenderPriority::Interactive, 0, H, [&](int i) {
+          if (this->restart) return;
+          double *d = &data[i * W];
+          dbltype yy = centerY + (i - H / 2) * scaleFactor;
+          if (!stats) {
+            fractal->EvaluateSpan(mandelbrot, orbit_trap, centerX, scaleFactor,
+                                  -W / 2, end, yy, d);
+            return;
+          }
+          // Same pixels as above, timed a tile width at a time.
+          for (int j0 = 0; j0 < end; j0 += kStatsTile) {
+            const auto tile_start = std::chrono::steady_clock::now();
+            fractal->EvaluateSpan(mandelbrot, orbit_trap, centerX, scaleFactor,
+                                  j0 - W / 2, std::min(kStatsTile, end - j0),
+                                  yy, d + j0);
+            row_ns[i * frame.tiles.width() + j0 / kStatsTile] =
+                std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - tile_start)
+                    .count();
+          }
+          if (escape) {
+            fractal->EvaluateSpan(mandelbrot, 0, centerX, scaleFactor, -W / 2,
+                                  end, yy, &frame.iterations[i * W]);
+          }
+        },
+        tunedGrain(local_params.fractal_family));
+    if (Tracer::instance().enabled()) {
+      Tracer::instance().complete("compute", trace_start);
     }
 
-    std::for_each(std::execution::par_unseq, indexs.begin(), indexs.end(),
-                  [&](int i) {
-                    if (this->restart) return;
-                    double *d = &data[i * W];
-                    dbltype yy = centerY + (i - H / 2) * scaleFactor;
-                    for (int k = -W / 2; k < W / 2; ++k) {
-                      d[k + W / 2] = f({centerX + k * scaleFactor, yy});
-                    }
-                  });
+    if (stats && !restart) {
+      frame.seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+      // The escape time coloring is the iteration count.
+      if (!escape) frame.iterations = data;
+      frame.total_iterations = std::accumulate(frame.iterations.begin(),
+                                               frame.iterations.end(), 0.0);
+      frame.pixels_per_second = N / std::max(frame.seconds, 1e-9);
+      const int max_iter = local_params.max_iterations;
+      frame.max_iter_share =
+          std::count_if(frame.iterations.begin(), frame.iterations.end(),
+                        [max_iter](double it) { return it >= max_iter; }) /
+          std::max(static_cast<double>(N), 1.0);
+      const int tiles_x = frame.tiles.width();
+      frame.tile_ms.fill(0.0, tiles_x * frame.tiles.height());
+      for (int i = 0; i < H; ++i) {
+        for (int t = 0; t < tiles_x; ++t) {
+          frame.tile_ms[i / kStatsTile * tiles_x + t] +=
+              row_ns[i * tiles_x + t] / 1e6;
+        }
+      }
+      emit renderedStats(frame);
+    }
 
     if (!restart) {
-      emit renderedImage(data, local_params.image_size, local_params.scale);
+      emitted_at_ = Tracer::instance().now();
+      emit renderedImage(data, QSize(W, H), local_params.scale);
     }
     mutex.lock();
     if (!restart) condition.wait(&mutex);
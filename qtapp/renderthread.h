@@ -50,15 +50,33 @@
 
 #ifndef RENDERTHREAD_H
 #define RENDERTHREAD_H
+#include <QMetaType>
 #include <QMutex>
+#include <QSize>
 #include <QThread>
+#include <QVector>
 #include <QWaitCondition>
+#include <atomic>
 
 QT_BEGIN_NAMESPACE
 class QImage;
 QT_END_NAMESPACE
 #include "fractals.h"
 
+// What a frame cost, see RenderThread::setCollectStats().
+struct RenderStats {
+  QSize size;
+  QVector<double> iterations;  // per pixel, whatever the coloring mode
+  int tile_size = 0;
+  QSize tiles;
+  QVector<double> tile_ms;  // compute time per tile, row-major
+  double seconds = 0.0;     // wall time of the frame
+  double total_iterations = 0.0;
+  double pixels_per_second = 0.0;
+  double max_iter_share = 0.0;  // pixels that reached max_iterations
+};
+Q_DECLARE_METATYPE(RenderStats)
+
 class RenderThread : public QThread {
   Q_OBJECT
 
@@ -66,10 +84,17 @@ class RenderThread : public QThread {
   RenderThread(QObject *parent = nullptr);
   ~RenderThread();
   void render(const FractalParameters &params);
+  // Measures the next frames and emits renderedStats() before each image.
+  // The iteration counts take a second pass when the coloring is not the
+  // escape time.
+  void setCollectStats(bool enabled) { collect_stats_ = enabled; }
+  // Tracer::now() when the last image was emitted, for tracing its delivery.
+  double emittedAt() const { return emitted_at_; }
 
  signals:
   void renderedImage(const QVector<double> &data, const QSize &size,
                      double scale);
+  void renderedStats(const RenderStats &stats);
 
  protected:
   void run() override;
@@ -79,13 +104,9 @@ class RenderThread : public QThread {
   QWaitCondition condition;
   bool restart = false;
   bool abort = false;
+  std::atomic<bool> collect_stats_{false};
+  std::atomic<double> emitted_at_{0.0};
   FractalParameters fractal_parameters_;
-  Family00 family00;
-  Family01 family01;
-  Family02 family02;
-  Family03 family03;
-  Family04 family04;
-  std::vector<int> indexs;
 };
 
 #endif  // RENDERTHREAD_H
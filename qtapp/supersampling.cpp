@@ -0,0 +1,74 @@
+#include "supersampling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Cheap stateless hash, so every pixel gets the same jitter regardless of
+// which thread renders it.
+inline double jitter(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (key >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}  // namespace
+
+size_t adaptiveSupersample(
+    std::vector<double> &data, int H, int W, int row0, double x0, double dx,
+    double y0, double dy,
+    const std::function<double(const std::complex<double> &)> &f, int n,
+    double threshold, RenderPriority priority) {
+  if (n < 2 || H <= 0 || W <= 0 || !(threshold > 0.0)) return 0;
+
+  // Edge detection on the 1 spp image.
+  std::vector<unsigned char> mask(data.size(), 0);
+  RenderScheduler::instance().parallelFor(priority, 0, H, [&](int i) {
+    const double *d = &data[static_cast<size_t>(i) * W];
+    const double *up = i > 0 ? d - W : d;
+    const double *down = i + 1 < H ? d + W : d;
+    unsigned char *m = &mask[static_cast<size_t>(i) * W];
+    for (int k = 0; k < W; ++k) {
+      const double v = d[k];
+      double diff = std::max(std::abs(v - up[k]), std::abs(v - down[k]));
+      if (k > 0) diff = std::max(diff, std::abs(v - d[k - 1]));
+      if (k + 1 < W) diff = std::max(diff, std::abs(v - d[k + 1]));
+      m[k] = diff > threshold;
+    }
+  });
+
+  // Re-sample the flagged pixels, accumulating the subsamples on the fly.
+  std::atomic<size_t> count{0};
+  const double sx = dx / n;
+  const double sy = dy / n;
+  const double inv = 1.0 / (n * n);
+  RenderScheduler::instance().parallelFor(priority, 0, H, [&](int i) {
+    const size_t base = static_cast<size_t>(i) * W;
+    size_t local = 0;
+    for (int k = 0; k < W; ++k) {
+      if (!mask[base + k]) continue;
+      const uint64_t pixel = static_cast<uint64_t>(row0 + i) * W + k;
+      const uint64_t key = pixel * static_cast<uint64_t>(n * n);
+      const double px = x0 + (k - 0.5) * dx;
+      const double py = y0 + (row0 + i - 0.5) * dy;
+      double sum = 0.0;
+      for (int a = 0; a < n; ++a) {
+        for (int b = 0; b < n; ++b) {
+          const uint64_t s = key + a * n + b;
+          sum += f({px + (b + jitter(2 * s)) * sx,
+                    py + (a + jitter(2 * s + 1)) * sy});
+        }
+      }
+      data[base + k] = sum * inv;
+      ++local;
+    }
+    count += local;
+  });
+  return count;
+}
@@ -0,0 +1,21 @@
+#ifndef SUPERSAMPLING_H
+#define SUPERSAMPLING_H
+#include <complex>
+#include <functional>
+#include <vector>
+
+#include "renderscheduler.h"
+
+// Adaptive supersampling of the already rendered rows [row0, row0 + H) of an
+// image W pixels wide whose pixel (i, k) was sampled at
+// (x0 + k * dx, y0 + i * dy). Pixels that differ from a 4-neighbour by more
+// than `threshold` are re-sampled with n x n jittered subsamples and replaced
+// by their mean. The edge detection and the re-sampling run on the
+// RenderScheduler with the given priority. Returns the number of re-sampled pixels.
+size_t adaptiveSupersample(
+    std::vector<double> &data, int H, int W, int row0, double x0, double dx,
+    double y0, double dy,
+    const std::function<double(const std::complex<double> &)> &f, int n,
+    double threshold, RenderPriority priority = RenderPriority::Export);
+
+#endif  // SUPERSAMPLING_H
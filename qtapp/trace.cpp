@@ -0,0 +1,84 @@
+#include "trace.h"
+
+#include <cstdio>
+
+Tracer &Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+bool Tracer::start(const std::string &fname) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Fail now rather than after the session.
+  FILE *out = std::fopen(fname.c_str(), "w");
+  if (!out) return false;
+  std::fclose(out);
+  fname_ = fname;
+  for (auto &buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->events.clear();
+  }
+  origin_ = std::chrono::steady_clock::now();
+  enabled_.store(true, std::memory_order_release);
+  return true;
+}
+
+bool Tracer::stop() {
+  if (!enabled_.exchange(false)) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  FILE *out = std::fopen(fname_.c_str(), "w");
+  if (!out) return false;
+  std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  bool first = true;
+  for (auto &buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    if (!buffer->name.empty()) {
+      std::fprintf(out,
+                   "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                   "\"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                   first ? "" : ",", buffer->tid, buffer->name.c_str());
+      first = false;
+    }
+    for (const Event &e : buffer->events) {
+      std::fprintf(out,
+                   "%s\n{\"name\": \"%s\", \"cat\": \"render\", \"ph\": \"X\", "
+                   "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                   first ? "" : ",", e.name, e.begin, e.duration, buffer->tid);
+      first = false;
+    }
+    buffer->events.clear();
+  }
+  std::fprintf(out, "\n]}\n");
+  return std::fclose(out) == 0;
+}
+
+double Tracer::now() const {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - origin_)
+      .count();
+}
+
+void Tracer::complete(const char *name, double begin) {
+  const double end = now();
+  ThreadBuffer &buffer = threadBuffer();
+  // Only contended while stop() writes the file.
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({name, begin, end - begin});
+}
+
+void Tracer::setThreadName(const std::string &name) {
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+Tracer::ThreadBuffer &Tracer::threadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer) {
+    buffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer->tid = static_cast<int>(buffers_.size()) + 1;
+    buffers_.push_back(buffer);
+  }
+  return *buffer;
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records timed spans per thread and writes them as Chrome trace-event JSON,
+// to be opened in chrome://tracing or ui.perfetto.dev. While disabled a trace
+// point costs one relaxed atomic load; while enabled a clock read and an
+// append to a buffer of its own thread.
+class Tracer {
+ public:
+  static Tracer &instance();
+
+  // Starts recording, the file is written by stop(). Returns false when it
+  // can not be created.
+  bool start(const std::string &fname);
+  // Stops recording and writes the spans recorded since start().
+  bool stop();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Microseconds since start().
+  double now() const;
+  // A span from `begin`, a now() of any thread, until now on this thread.
+  // `name` must outlive the tracer, string literals are meant.
+  void complete(const char *name, double begin);
+  // Names the track of this thread.
+  void setThreadName(const std::string &name);
+
+ private:
+  struct Event {
+    const char *name;
+    double begin, duration;
+  };
+  struct ThreadBuffer {
+    std::mutex mutex;
+    int tid;
+    std::string name;
+    std::vector<Event> events;
+  };
+
+  Tracer() = default;
+  ThreadBuffer &threadBuffer();
+
+  std::atomic<bool> enabled_{false};
+  std::chrono::steady_clock::time_point origin_;
+  std::string fname_;
+  std::mutex mutex_;
+  // Kept after their threads exit, so their spans still are written.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+// A span from the construction to the end of the scope.
+class TraceScope {
+ public:
+  explicit TraceScope(const char *name)
+      : name_(Tracer::instance().enabled() ? name : nullptr),
+        begin_(name_ ? Tracer::instance().now() : 0.0) {}
+  ~TraceScope() {
+    if (name_) Tracer::instance().complete(name_, begin_);
+  }
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  const char *name_;
+  double begin_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif  // TRACE_H